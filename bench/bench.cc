@@ -0,0 +1,195 @@
+// bench.cc
+// 固定种子的基准场景，输出可跨版本比较的 JSON 报告
+//
+//   CsI_Axion_bench [--events N] [--output benchmark.json] [scenario ...]
+//
+// 每个场景在单独的子进程中运行（物理列表和几何只能初始化一次），
+// 父进程用 wait4() 取得子进程的峰值 RSS。场景的配置在 mac/bench_*.mac 中。
+
+#include "ActionInitialization.hh"
+#include "BenchmarkTimer.hh"
+#include "DetectorConstruction.hh"
+#include "PhysicsList.hh"
+
+#include <G4RunManager.hh>
+#include <G4UImanager.hh>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#ifndef CSI_VERSION
+#define CSI_VERSION "unknown"
+#endif
+
+namespace {
+
+struct Scenario {
+  const char *name;
+  const char *macro;
+  G4int events; // default event count
+};
+
+const Scenario kScenarios[] = {
+    {"noOptics", "bench_noOptics.mac", 2000},
+    {"opticsAir", "bench_opticsAir.mac", 5},
+    {"opticsGrease", "bench_opticsGrease.mac", 5},
+    {"opticsDetect", "bench_opticsDetect.mac", 5},
+    {"shower", "bench_shower.mac", 200},
+};
+
+// 子进程：运行一个场景，把结果（JSON 字段，不含括号）写入 fd
+int RunScenario(const Scenario &scenario, G4int nEvents, int fd) {
+  auto runManager = new G4RunManager();
+  runManager->SetUserInitialization(new DetectorConstruction());
+  runManager->SetUserInitialization(new PhysicsList());
+  runManager->SetUserInitialization(new ActionInitialization());
+
+  auto UImanager = G4UImanager::GetUIpointer();
+  if (UImanager->ApplyCommand(G4String("/control/execute ") +
+                              scenario.macro) != 0) {
+    G4cerr << "[bench] Cannot execute " << scenario.macro << G4endl;
+    return 1;
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  runManager->BeamOn(nEvents);
+  auto t1 = std::chrono::steady_clock::now();
+  G4double beamOn = std::chrono::duration<G4double>(t1 - t0).count();
+
+  // RunAction::EndOfRunAction 已把计时合并到 RunTotals()。
+  // 速率只用事件循环的时间：第一次 BeamOn 还要构建物理表、打开输出文件
+  const BenchmarkTimer::Totals &totals = BenchmarkTimer::RunTotals();
+  G4double wall = totals.eventLoopSeconds;
+  G4long steps = totals.counts[BenchmarkTimer::kSteps];
+  G4double userSeconds = 0.;
+
+  std::ostringstream out;
+  out << "\"name\": \"" << scenario.name << "\", \"events\": " << nEvents
+      << ", \"wall_s\": " << wall << ", \"setup_s\": " << beamOn - wall
+      << ", \"events_per_s\": " << (wall > 0. ? nEvents / wall : 0.)
+      << ", \"steps\": " << steps
+      << ", \"steps_per_s\": " << (wall > 0. ? steps / wall : 0.)
+      << ", \"sections\": {";
+  for (G4int i = 0; i < BenchmarkTimer::kNSections; i++) {
+    if (i < BenchmarkTimer::kNTopLevel)
+      userSeconds += totals.seconds[i];
+    out << (i ? ", " : "") << "\"" << BenchmarkTimer::SectionName(i)
+        << "\": {\"seconds\": " << totals.seconds[i]
+        << ", \"calls\": " << totals.calls[i] << "}";
+  }
+  // 其余时间是 Geant4 本身（输运、物理过程、导航）
+  out << ", \"Geant4\": {\"seconds\": " << wall - userSeconds << "}}";
+  out << ", \"counters\": {";
+  for (G4int i = 0; i < BenchmarkTimer::kNCounters; i++)
+    out << (i ? ", " : "") << "\"" << BenchmarkTimer::CounterName(i)
+        << "\": " << totals.counts[i];
+  out << "}";
+
+  std::string text = out.str();
+  if (write(fd, text.data(), text.size()) != (ssize_t)text.size())
+    return 1;
+
+  delete runManager;
+  return 0;
+}
+
+void PrintUsage() {
+  G4cout << "Usage: CsI_Axion_bench [--events N] [--output file] "
+            "[scenario ...]\nScenarios:";
+  for (const auto &s : kScenarios)
+    G4cout << " " << s.name;
+  G4cout << G4endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  G4int nEvents = 0; // 0: per-scenario default
+  std::string outputName = "benchmark.json";
+  std::vector<const Scenario *> selected;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--events" && i + 1 < argc) {
+      nEvents = std::atoi(argv[++i]);
+    } else if (arg == "--output" && i + 1 < argc) {
+      outputName = argv[++i];
+    } else if (arg == "--help") {
+      PrintUsage();
+      return 0;
+    } else {
+      const Scenario *found = nullptr;
+      for (const auto &s : kScenarios)
+        if (arg == s.name)
+          found = &s;
+      if (!found) {
+        G4cerr << "[bench] Unknown scenario: " << arg << G4endl;
+        PrintUsage();
+        return 1;
+      }
+      selected.push_back(found);
+    }
+  }
+  if (selected.empty())
+    for (const auto &s : kScenarios)
+      selected.push_back(&s);
+
+  std::ostringstream report;
+  report << "{\n  \"version\": \"" << CSI_VERSION << "\",\n  \"scenarios\": [";
+  G4int nFailed = 0, nWritten = 0;
+  for (size_t k = 0; k < selected.size(); k++) {
+    const Scenario &scenario = *selected[k];
+    G4int events = nEvents > 0 ? nEvents : scenario.events;
+    G4cout << "[bench] " << scenario.name << ": " << events << " events"
+           << G4endl;
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+      G4cerr << "[bench] pipe() failed" << G4endl;
+      return 1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      int rc = RunScenario(scenario, events, fds[1]);
+      close(fds[1]);
+      _exit(rc);
+    }
+    close(fds[1]);
+
+    std::string fields;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+      fields.append(buffer, n);
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || fields.empty()) {
+      G4cerr << "[bench] Scenario " << scenario.name << " failed" << G4endl;
+      nFailed++;
+      continue;
+    }
+
+    // Linux 下 ru_maxrss 的单位是 kB
+    report << (nWritten++ ? "," : "") << "\n    {" << fields
+           << ", \"peak_rss_kb\": " << usage.ru_maxrss << "}";
+  }
+  report << "\n  ]\n}\n";
+
+  std::ofstream out(outputName);
+  out << report.str();
+  G4cout << "[bench] Report written to " << outputName << G4endl;
+  return nFailed > 0 ? 1 : 0;
+}
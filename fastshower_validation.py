@@ -0,0 +1,134 @@
+import argparse
+import os
+import sys
+
+import awkward as ak
+import matplotlib.pyplot as plt
+import numpy as np
+import uproot
+
+
+def load_events(root_file):
+    """读取 TotalEdep 和逐 hit 的晶体能量（需要 /CsI/output/hitColumns true）"""
+    if not os.path.exists(root_file):
+        print(f"Error: File '{root_file}' not found.")
+        sys.exit(1)
+    with uproot.open(root_file) as file:
+        if "CsI;1" not in file:
+            print(f"Error: TTree 'CsI' not found in {root_file}. Available keys: {file.keys()}")
+            sys.exit(1)
+        data = file["CsI"].arrays(["TotalEdep", "CrystalIndex", "CrystalEdep"], library="ak")
+    print(f"[Info] {root_file}: {len(data)} events")
+    return data
+
+
+def summarize(data):
+    """TotalEdep 的均值、RMS，各晶体的能量份额，以及最热晶体占本事件能量的比例"""
+    total = ak.to_numpy(data["TotalEdep"])
+    hit = total > 0
+
+    index = ak.to_numpy(ak.flatten(data["CrystalIndex"]))
+    edep = ak.to_numpy(ak.flatten(data["CrystalEdep"]))
+    sharing = np.bincount(index, weights=edep) / max(edep.sum(), 1e-30)
+
+    hottest = ak.to_numpy(ak.fill_none(ak.max(data["CrystalEdep"], axis=1), 0.0))
+    hottest_fraction = hottest[hit] / total[hit]
+
+    return {
+        "total": total,
+        "mean": total.mean(),
+        "rms": total.std(),
+        "sharing": sharing,
+        "hottest_fraction": hottest_fraction,
+    }
+
+
+def compare(full_file, fast_file, output_dir="plots", tolerance=0.02):
+    full = summarize(load_events(full_file))
+    fast = summarize(load_events(fast_file))
+
+    # ==========================================
+    # 1. TotalEdep 的均值和 RMS
+    # ==========================================
+    mean_shift = fast["mean"] / full["mean"] - 1.0
+    rms_shift = fast["rms"] / full["rms"] - 1.0
+    print("\n--- TotalEdep (MeV) ---")
+    print(f"  {'':8s} {'full':>10s} {'gflash':>10s} {'diff':>8s}")
+    print(f"  {'mean':8s} {full['mean']:10.3f} {fast['mean']:10.3f} {100 * mean_shift:7.2f}%")
+    print(f"  {'rms':8s} {full['rms']:10.3f} {fast['rms']:10.3f} {100 * rms_shift:7.2f}%")
+
+    # ==========================================
+    # 2. 各晶体的能量份额（按完整模拟排序的前 10 个）
+    # ==========================================
+    n = max(len(full["sharing"]), len(fast["sharing"]))
+    share_full = np.pad(full["sharing"], (0, n - len(full["sharing"])))
+    share_fast = np.pad(fast["sharing"], (0, n - len(fast["sharing"])))
+    # 两个份额分布之差的一半 = 需要搬到别的晶体的能量比例
+    sharing_distance = 0.5 * np.abs(share_full - share_fast).sum()
+    print("\n--- Per-crystal energy sharing ---")
+    print(f"  {'index':>6s} {'full':>8s} {'gflash':>8s}")
+    for i in np.argsort(share_full)[::-1][:10]:
+        print(f"  {i:6d} {100 * share_full[i]:7.2f}% {100 * share_fast[i]:7.2f}%")
+    print(f"  Energy moved between crystals: {100 * sharing_distance:.2f}%")
+    print(
+        f"  Hottest crystal / event energy: full {full['hottest_fraction'].mean():.3f}, "
+        f"gflash {fast['hottest_fraction'].mean():.3f}"
+    )
+
+    # ==========================================
+    # 3. 图
+    # ==========================================
+    if not os.path.exists(output_dir):
+        os.makedirs(output_dir)
+
+    emax = max(full["total"].max(), fast["total"].max()) * 1.1
+    plt.figure(figsize=(10, 6))
+    plt.hist(full["total"], bins=100, range=(0, emax), histtype="step", label="Full simulation")
+    plt.hist(fast["total"], bins=100, range=(0, emax), histtype="step", label="GFlash")
+    plt.xlabel("Energy (MeV)")
+    plt.ylabel("Counts")
+    plt.title("Total Energy Deposition: full vs. fast shower")
+    plt.legend()
+    plt.grid(True, alpha=0.3)
+    plt.savefig(f"{output_dir}/FastShower_TotalEdep.png")
+    print(f"\nSaved {output_dir}/FastShower_TotalEdep.png")
+
+    plt.figure(figsize=(10, 6))
+    plt.step(range(n), share_full, where="mid", label="Full simulation")
+    plt.step(range(n), share_fast, where="mid", label="GFlash")
+    plt.xlabel("Crystal index")
+    plt.ylabel("Fraction of deposited energy")
+    plt.yscale("log")
+    plt.legend()
+    plt.grid(True, alpha=0.3)
+    plt.savefig(f"{output_dir}/FastShower_Sharing.png")
+    print(f"Saved {output_dir}/FastShower_Sharing.png")
+
+    plt.figure(figsize=(10, 6))
+    plt.hist(full["hottest_fraction"], bins=50, range=(0, 1), histtype="step", label="Full simulation")
+    plt.hist(fast["hottest_fraction"], bins=50, range=(0, 1), histtype="step", label="GFlash")
+    plt.xlabel("Hottest crystal / event energy")
+    plt.ylabel("Counts")
+    plt.legend()
+    plt.grid(True, alpha=0.3)
+    plt.savefig(f"{output_dir}/FastShower_HottestFraction.png")
+    print(f"Saved {output_dir}/FastShower_HottestFraction.png")
+
+    ok = abs(mean_shift) <= tolerance and abs(rms_shift) <= 5 * tolerance and sharing_distance <= 5 * tolerance
+    print(f"\n{'PASS' if ok else 'FAIL'} (mean within {100 * tolerance:.1f}%, rms and sharing within {500 * tolerance:.1f}%)")
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare GFlash fast-shower output with full simulation (mac/fastshower_validation.mac).")
+    parser.add_argument("full", help="ROOT file from the full simulation (/GFlash/flag 0)")
+    parser.add_argument("fast", help="ROOT file from the parametrised run (/GFlash/flag 1)")
+    parser.add_argument("-o", "--output", default="plots", help="Output directory for plots")
+    parser.add_argument("-t", "--tolerance", type=float, default=0.02, help="Allowed relative shift of the TotalEdep mean")
+
+    args = parser.parse_args()
+    sys.exit(0 if compare(args.full, args.fast, args.output, args.tolerance) else 1)
+
+
+if __name__ == "__main__":
+    main()
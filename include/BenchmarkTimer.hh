@@ -0,0 +1,172 @@
+// BenchmarkTimer.hh
+#ifndef BENCHMARK_TIMER_HH
+#define BENCHMARK_TIMER_HH
+
+#include "G4AutoLock.hh"
+#include "globals.hh"
+#include <chrono>
+#include <ostream>
+
+// 用户代码的计时和计数
+// 只在定义了 CSI_BENCHMARK 时编译进去（CsI_Axion_bench 目标，或
+// cmake -DCSI_PROFILING=ON），否则 CSI_BENCH_SCOPE / CSI_BENCH_COUNT
+// 展开为空，正常程序没有任何开销。
+//
+// 每个线程在自己的 ThreadTotals() 中累计；RunAction::EndOfRunAction
+// 把各线程的结果合并到 RunTotals()（master 最后执行，负责打印）。
+namespace BenchmarkTimer {
+
+// kNTopLevel 之前的部分互不嵌套，之和就是用户代码的总时间；
+// 之后的部分嵌套在某个顶层部分内
+enum Section {
+  kProcessHits,
+  kSteppingAction,
+  kTrackingAction,
+  kEventAction,
+  kNTopLevel,
+  kTrajectory = kNTopLevel, // in TrackingAction
+  kAnalysisFill,            // in EventAction
+  kNSections
+};
+
+enum Counter {
+  kEvents,
+  kSteps,
+  kHits,
+  kOpticalPhotons,
+  kTrajectories,
+  kNCounters
+};
+
+inline const char *SectionName(G4int section) {
+  static const char *names[kNSections] = {
+      "ProcessHits", "SteppingAction", "TrackingAction",
+      "EventAction", "Trajectory",     "AnalysisFill"};
+  return names[section];
+}
+
+inline const char *CounterName(G4int counter) {
+  static const char *names[kNCounters] = {"Events", "Steps", "Hits",
+                                          "OpticalPhotons", "Trajectories"};
+  return names[counter];
+}
+
+struct Totals {
+  G4double seconds[kNSections] = {};
+  G4long calls[kNSections] = {};
+  G4long counts[kNCounters] = {};
+  // 事件循环的墙钟时间：BeginOfRunAction 结束到 EndOfRunAction 开始，
+  // 不含物理表构建和输出文件的打开/写出（只由 master 记录）
+  G4double eventLoopSeconds = 0.;
+
+  void Add(const Totals &other) {
+    eventLoopSeconds += other.eventLoopSeconds;
+    for (G4int i = 0; i < kNSections; i++) {
+      seconds[i] += other.seconds[i];
+      calls[i] += other.calls[i];
+    }
+    for (G4int i = 0; i < kNCounters; i++)
+      counts[i] += other.counts[i];
+  }
+  void Reset() { *this = Totals(); }
+};
+
+// 每个线程一份
+inline Totals &ThreadTotals() {
+  static G4ThreadLocal Totals *totals = nullptr;
+  if (!totals)
+    totals = new Totals();
+  return *totals;
+}
+
+// 整个 run 的合计（所有线程）
+inline Totals &RunTotals() {
+  static Totals totals;
+  return totals;
+}
+
+inline std::chrono::steady_clock::time_point &EventLoopStart() {
+  static std::chrono::steady_clock::time_point start;
+  return start;
+}
+
+// BeginOfRunAction 的最后调用
+inline void StartEventLoop() {
+  EventLoopStart() = std::chrono::steady_clock::now();
+}
+
+// EndOfRunAction 的开头调用
+inline void StopEventLoop() {
+  auto elapsed = std::chrono::steady_clock::now() - EventLoopStart();
+  RunTotals().eventLoopSeconds =
+      std::chrono::duration<G4double>(elapsed).count();
+}
+
+inline G4Mutex &RunTotalsMutex() {
+  static G4Mutex mutex = G4MUTEX_INITIALIZER;
+  return mutex;
+}
+
+// 把本线程的结果加到 RunTotals() 并清零
+inline void MergeThread() {
+  G4AutoLock lock(&RunTotalsMutex());
+  RunTotals().Add(ThreadTotals());
+  ThreadTotals().Reset();
+}
+
+inline void Print(const Totals &totals, std::ostream &out) {
+  G4long nEvents = totals.counts[kEvents];
+  G4double userSeconds = 0.;
+  for (G4int i = 0; i < kNTopLevel; i++)
+    userSeconds += totals.seconds[i];
+
+  out << "Section\tCalls\tSeconds\tMicrosecondsPerCall\n";
+  for (G4int i = 0; i < kNSections; i++) {
+    out << SectionName(i) << "\t" << totals.calls[i] << "\t"
+        << totals.seconds[i] << "\t"
+        << (totals.calls[i] > 0 ? 1e6 * totals.seconds[i] / totals.calls[i]
+                                : 0.)
+        << "\n";
+  }
+  out << "UserTotal\t-\t" << userSeconds << "\t-\n";
+  out << "EventLoop\t-\t" << totals.eventLoopSeconds << "\t-\n";
+  out << "Counter\tTotal\tPerEvent\n";
+  for (G4int i = 0; i < kNCounters; i++) {
+    out << CounterName(i) << "\t" << totals.counts[i] << "\t"
+        << (nEvents > 0 ? static_cast<G4double>(totals.counts[i]) / nEvents
+                        : 0.)
+        << "\n";
+  }
+}
+
+class Scope {
+public:
+  explicit Scope(Section section)
+      : fSection(section), fStart(std::chrono::steady_clock::now()) {}
+  ~Scope() {
+    Totals &totals = ThreadTotals();
+    totals.seconds[fSection] +=
+        std::chrono::duration<G4double>(std::chrono::steady_clock::now() -
+                                        fStart)
+            .count();
+    totals.calls[fSection]++;
+  }
+
+private:
+  Section fSection;
+  std::chrono::steady_clock::time_point fStart;
+};
+
+} // namespace BenchmarkTimer
+
+#ifdef CSI_BENCHMARK
+#define CSI_BENCH_SCOPE(section)                                               \
+  BenchmarkTimer::Scope csiBenchScope##section(BenchmarkTimer::section)
+#define CSI_BENCH_COUNT(counter, n)                                            \
+  (BenchmarkTimer::ThreadTotals().counts[BenchmarkTimer::counter] += (n))
+#else
+#define CSI_BENCH_SCOPE(section)
+#define CSI_BENCH_COUNT(counter, n) ((void)0)
+#endif
+
+#endif
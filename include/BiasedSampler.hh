@@ -0,0 +1,58 @@
+// BiasedSampler.hh
+#ifndef BIASED_SAMPLER_HH
+#define BIASED_SAMPLER_HH
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+#include <vector>
+
+// 分段常数概率密度，从文本文件读取
+// 每行: low high density（# 开头为注释），x 的单位由调用者给出
+class PiecewisePDF {
+public:
+  // 区间截断到 [0, xmax] 后归一化；返回有效区间数
+  G4int Load(const G4String &fileName, G4double unit, G4double xmax);
+  void Clear();
+  G4bool IsEmpty() const { return fLow.empty(); }
+  // 区间的并集是否覆盖 [0, xmax]（中间没有空隙）
+  G4bool Covers(G4double xmax) const;
+
+  // 抽样 x，并返回该处归一化后的密度
+  G4double Sample(G4double &density) const;
+
+private:
+  std::vector<G4double> fLow;
+  std::vector<G4double> fHigh;
+  std::vector<G4double> fDensity;    // normalized
+  std::vector<G4double> fCumulative; // normalized cumulative probability
+};
+
+// 顶点位置与能量的重要性抽样
+// 名义分布：晶体内均匀的位置、[0, maxEnergy] 内均匀的能量。
+// 设置了偏置密度 q 后按 q 抽样，并把 p/q 乘到事件权重上：
+//   能量:   p(E) = 1 / maxEnergy
+//   边界距: d = 到最近晶体面的距离，均匀体积下 p(d) = 24 h^2 / s^3,
+//           h = s/2 - d；给定 d 的点在边长 2h 的同心立方体表面上均匀分布
+// q 必须在名义分布非零处都非零，否则这些区域不会被抽到：不覆盖整个
+// 范围的 PDF 文件被拒绝，保留原来的 PDF。
+// 未设置偏置时与原来的均匀抽样消耗相同的随机数，权重为 1。
+class BiasedSampler {
+public:
+  // 返回有效区间数；0 表示读取失败或不覆盖 [0, maxEnergy]
+  G4int LoadEnergyPDF(const G4String &fileName, G4double maxEnergy);
+  G4int LoadBoundaryPDF(const G4String &fileName, G4double crystalSize);
+  void ClearEnergyPDF() { fEnergyPDF.Clear(); }
+  void ClearBoundaryPDF() { fBoundaryPDF.Clear(); }
+
+  // 均匀 [0, maxEnergy] 或偏置抽样；偏置时 weight *= p/q
+  G4double SampleEnergy(G4double maxEnergy, G4double &weight) const;
+  // 相对晶体中心的位置，晶体边长 crystalSize
+  G4ThreeVector SampleLocalPosition(G4double crystalSize,
+                                    G4double &weight) const;
+
+private:
+  PiecewisePDF fEnergyPDF;
+  PiecewisePDF fBoundaryPDF;
+};
+
+#endif
@@ -0,0 +1,83 @@
+// Checkpoint.hh
+#ifndef CHECKPOINT_HH
+#define CHECKPOINT_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+
+#include <chrono>
+#include <map>
+
+// 长时间 production run 的检查点和续跑 (/CsI/checkpoint/)
+//
+// 打开后（everyEvents 或 interval 大于 0）输出按检查点分段:
+// <fileName>_part0.root, _part1.root ...。到检查点时（事件结束后）
+// 关闭当前 part（已模拟的事件落盘），保存随机数引擎状态和
+// <fileName>.checkpoint（已完成事件数、总事件数、下一个 part、ProcessID 表），
+// 再打开下一个 part。run 正常结束时用 hadd 把 part 合并为 <fileName>.root，
+// 并删除检查点文件。
+//
+// 作业被中断后，用同样的设置宏加 /CsI/checkpoint/resume（代替 /run/beamOn）:
+// 从最后一个检查点恢复随机数引擎，EventID 接着编号，只模拟剩余的事件，
+// 合并后的输出（ntuple 行和直方图）与不中断的 run 相同。
+// 只有这两者被精确恢复：run 总结中的统计（EventWatchdog 的触发计数、
+// MemoryMonitor 的高水位、StepStatistics 的计数）不写进检查点，
+// 续跑后只包含续跑这一段的事件。
+// 需要顺序模式（G4RunManager）；多线程时各线程的随机数由 master 分发，
+// 这里不支持，打印警告后关闭。
+// /CsI/checkpoint/exitAfter N 在第 N 个检查点之后立即结束进程（测试用，
+// 模拟被中断的作业，见 tests/test_checkpoint_resume.py）。
+class Checkpoint {
+public:
+  // outputName: RunAction 的 /CsI/output/fileName（不含扩展名）
+  explicit Checkpoint(const G4String &outputName);
+  ~Checkpoint();
+
+  // BeginOfRunAction: 新 run 从头开始，续跑时恢复随机数引擎和 ProcessID 表
+  void BeginRun(G4int nEvents, std::map<G4String, int> &processMap);
+  // 本 run 是否按 part 分段输出
+  G4bool IsActive() const { return fActive; }
+  G4String PartFileName() const;
+  // 续跑时加到 Geant4 EventID 上的偏移
+  G4int GetEventOffset() const { return fActive ? fEventOffset : 0; }
+
+  // 事件结束后：是否该写检查点（按事件数或时间）
+  G4bool IsDue(G4int eventsDone) const;
+  // 当前 part 已关闭：保存状态，下一个 part 序号
+  void Save(G4int eventsDone, const std::map<G4String, int> &processMap);
+  // EndOfRunAction，最后一个 part 已关闭：合并 part，清理检查点文件
+  void EndRun();
+
+private:
+  struct State {
+    G4int eventsDone = 0;
+    G4int eventsTotal = 0;
+    G4int part = 0;
+    std::map<G4String, int> processMap;
+  };
+
+  void Resume();
+  G4bool ReadState(State &state) const;
+  G4String StateFileName() const { return fOutputName + ".checkpoint"; }
+  G4String EngineFileName() const { return StateFileName() + ".rndm"; }
+
+  G4GenericMessenger *fMessenger;
+  const G4String &fOutputName;
+  G4int fEveryEvents;   // 0 = 不按事件数
+  G4double fInterval;   // 0 = 不按时间
+  G4int fExitAfter;     // 测试用：第 N 个检查点后退出，0 = 关闭
+  G4int fSaves;         // 本进程写过的检查点数
+
+  G4bool fResumePending;
+  State fResumeState;
+
+  // 当前 run
+  G4bool fActive;
+  G4int fEventOffset;
+  G4int fEventsTotal;
+  G4int fPart;
+  G4int fLastSaved; // 上次检查点时已完成的事件数
+  std::chrono::steady_clock::time_point fLastSaveTime;
+};
+
+#endif
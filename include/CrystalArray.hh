@@ -0,0 +1,72 @@
+// CrystalArray.hh
+#ifndef CRYSTAL_ARRAY_HH
+#define CRYSTAL_ARRAY_HH
+
+#include "globals.hh"
+
+// CsI 晶体阵列的尺寸常量与编号
+// index  = (ix * kNy + iy) * kNz + iz, 连续的 0..kNCrystals-1
+//          作为放置时的 copy number，SD/步进/输出内部都用它做扁平数组下标
+// copyNo = ix * 10000 + iy * 100 + iz, 旧的 XXYYZZ 编码，
+//          只作为输出中的 CrystalID 列和刻度文件的晶体编号
+namespace CrystalArray {
+
+constexpr G4int kNx = 8; // x方向晶体数
+constexpr G4int kNy = 8; // y方向晶体数
+constexpr G4int kNz = 5; // z方向晶体数
+constexpr G4int kNCrystals = kNx * kNy * kNz;
+
+inline G4int EncodeIndex(G4int ix, G4int iy, G4int iz) {
+  return (ix * kNy + iy) * kNz + iz;
+}
+inline G4int EncodeCopyNo(G4int ix, G4int iy, G4int iz) {
+  return ix * 10000 + iy * 100 + iz;
+}
+inline G4int CopyNoX(G4int copyNo) { return copyNo / 10000; }
+inline G4int CopyNoY(G4int copyNo) { return (copyNo % 10000) / 100; }
+inline G4int CopyNoZ(G4int copyNo) { return copyNo % 100; }
+
+// index -> (ix, iy, iz, XXYYZZ) 的预计算解码表
+struct DecodeTable {
+  G4int ix[kNCrystals];
+  G4int iy[kNCrystals];
+  G4int iz[kNCrystals];
+  G4int copyNo[kNCrystals];
+
+  DecodeTable() {
+    for (G4int x = 0; x < kNx; x++)
+      for (G4int y = 0; y < kNy; y++)
+        for (G4int z = 0; z < kNz; z++) {
+          G4int i = EncodeIndex(x, y, z);
+          ix[i] = x;
+          iy[i] = y;
+          iz[i] = z;
+          copyNo[i] = EncodeCopyNo(x, y, z);
+        }
+  }
+};
+
+inline const DecodeTable &Decode() {
+  static const DecodeTable table;
+  return table;
+}
+
+inline G4int IndexX(G4int index) { return Decode().ix[index]; }
+inline G4int IndexY(G4int index) { return Decode().iy[index]; }
+inline G4int IndexZ(G4int index) { return Decode().iz[index]; }
+inline G4int IndexToCopyNo(G4int index) { return Decode().copyNo[index]; }
+
+// XXYYZZ 的每一位都在阵列范围内（例如 199 = (0, 1, 99) 不是有效编号）
+inline G4bool IsValidCopyNo(G4int copyNo) {
+  G4int x = CopyNoX(copyNo), y = CopyNoY(copyNo), z = CopyNoZ(copyNo);
+  return copyNo >= 0 && x < kNx && y < kNy && z < kNz;
+}
+
+// 调用方先用 IsValidCopyNo 检查
+inline G4int CopyNoToIndex(G4int copyNo) {
+  return EncodeIndex(CopyNoX(copyNo), CopyNoY(copyNo), CopyNoZ(copyNo));
+}
+
+} // namespace CrystalArray
+
+#endif
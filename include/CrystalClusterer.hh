@@ -0,0 +1,62 @@
+// CrystalClusterer.hh
+#ifndef CRYSTAL_CLUSTERER_HH
+#define CRYSTAL_CLUSTERER_HH
+
+#include "G4GenericMessenger.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+#include <vector>
+
+struct CsICluster {
+  G4double energy;        // sum of the member crystal deposits
+  G4ThreeVector centroid; // energy-weighted mean of the crystal centres
+  G4double time;          // earliest member time
+  G4int size;             // number of member crystals
+  G4int seedCopyNo;       // XXYYZZ copy number of the most energetic crystal
+};
+
+// 着火晶体的三维近邻聚类
+// 8x8x5 阵列上每个晶体的近邻表（6: 共面, 18: 共面+共棱, 26: 再加共顶点）
+// 只在连通方式改变时重建；每个事件把沉积散射到按晶体连续索引的扁平数组，
+// 按能量从高到低取未归类的晶体作为种子做广度优先搜索，
+// 种子能量低于 seedThreshold 的连通块不输出。
+class CrystalClusterer {
+public:
+  CrystalClusterer();
+  ~CrystalClusterer();
+
+  // 重建近邻表（连通方式改变时）并从几何读取晶体中心
+  void Prepare();
+
+  // index: dense crystal index (CrystalArray)
+  void AddDeposit(G4int index, G4double edep, G4double time);
+  // 聚类当前事件的沉积并清空输入
+  void Reconstruct();
+
+  const std::vector<CsICluster> &GetClusters() const { return fClusters; }
+
+private:
+  void BuildNeighbourTable();
+
+  G4GenericMessenger *fMessenger;
+  G4int fConnectivity;       // 6, 18 or 26
+  G4double fCrystalThreshold; // crystals below this are ignored
+  G4double fSeedThreshold;    // minimum seed deposit of an output cluster
+
+  // Neighbour table: fNeighbours[i * 26 + k], k < fNNeighbours[i]
+  G4int fTableConnectivity;
+  std::vector<G4int> fNeighbours;
+  std::vector<G4int> fNNeighbours;
+  std::vector<G4ThreeVector> fCentre;
+
+  // Per-event work arrays, indexed by the dense crystal index
+  std::vector<G4double> fEdep;
+  std::vector<G4double> fTime;
+  std::vector<G4int> fLabel; // cluster number, -1 = unassigned
+  std::vector<G4int> fFired; // indices with a deposit this event
+  std::vector<G4int> fQueue;
+
+  std::vector<CsICluster> fClusters;
+};
+
+#endif
@@ -0,0 +1,97 @@
+// CsIDigitizer.hh
+#ifndef CSI_DIGITIZER_HH
+#define CSI_DIGITIZER_HH
+
+#include "G4Allocator.hh"
+#include "G4GenericMessenger.hh"
+#include "G4TDigiCollection.hh"
+#include "G4VDigi.hh"
+#include "G4VDigitizerModule.hh"
+#include <vector>
+
+// 每个晶体一个 digi：整数 ADC（扣除基线）和 TDC
+class CsIDigi : public G4VDigi {
+public:
+  CsIDigi();
+  virtual ~CsIDigi();
+
+  inline void *operator new(size_t);
+  inline void operator delete(void *);
+
+  void Draw() override {}
+  void Print() override;
+
+  void SetCrystalID(G4int id) { fCrystalID = id; }
+  void SetADC(G4int adc) { fADC = adc; }
+  void SetTDC(G4int tdc) { fTDC = tdc; }
+
+  G4int GetCrystalID() const { return fCrystalID; }
+  G4int GetADC() const { return fADC; }
+  G4int GetTDC() const { return fTDC; } // -1: noise-only digi, no timing
+
+private:
+  G4int fCrystalID; // XXYYZZ copy number
+  G4int fADC;
+  G4int fTDC;
+};
+
+typedef G4TDigiCollection<CsIDigi> CsIDigitsCollection;
+
+extern G4ThreadLocal G4Allocator<CsIDigi> *CsIDigiAllocator;
+
+inline void *CsIDigi::operator new(size_t) {
+  if (!CsIDigiAllocator)
+    CsIDigiAllocator = new G4Allocator<CsIDigi>;
+  return (void *)CsIDigiAllocator->MallocSingle();
+}
+
+inline void CsIDigi::operator delete(void *digi) {
+  CsIDigiAllocator->FreeSingle((CsIDigi *)digi);
+}
+
+// 晶体能量沉积 -> 光电子数 -> ADC/TDC
+// 每个晶体有独立的刻度参数（光产额、量子效率、噪声、阈值、增益），
+// 所有量存放在按晶体连续索引（即放置的 copy number）的扁平数组中，
+// 每个事件对全部 320 个晶体统一处理（包括只有噪声的晶体）。
+//
+// 刻度文件格式（每行一个晶体，# 开头为注释）:
+//   CrystalID(XXYYZZ) LightYield[1/MeV] QE Noise[ADC] Threshold[ADC]
+//   Gain[ADC/pe]
+class CsIDigitizer : public G4VDigitizerModule {
+public:
+  CsIDigitizer(const G4String &name);
+  virtual ~CsIDigitizer();
+
+  virtual void Digitize() override;
+
+  // 对全部晶体设置统一的刻度值
+  void SetLightYield(G4double perMeV);
+  void SetQuantumEfficiency(G4double qe);
+  void SetNoise(G4double adc);
+  void SetThreshold(G4double adc);
+  void SetGain(G4double adcPerPE);
+  // 按晶体覆盖刻度值
+  void LoadCalibration(const G4String &fileName);
+
+private:
+  G4GenericMessenger *fMessenger;
+  G4int fHCID;
+
+  // Per-crystal calibration, indexed by the dense crystal index
+  std::vector<G4double> fLightYield; // scintillation photons per MeV
+  std::vector<G4double> fQE;         // photodetector quantum efficiency
+  std::vector<G4double> fNoise;      // electronic noise sigma (ADC counts)
+  std::vector<G4double> fThreshold;  // zero-suppression threshold (ADC)
+  std::vector<G4double> fGain;       // ADC counts per photoelectron
+
+  G4int fAdcMax;            // ADC saturation
+  G4double fTimeResolution; // Gaussian time smearing
+  G4double fTdcLSB;         // TDC bin width
+
+  // Per-event work arrays, indexed by the dense crystal index
+  std::vector<G4double> fEdep;
+  std::vector<G4double> fTime;
+  std::vector<G4double> fNoiseSample;
+};
+
+#endif
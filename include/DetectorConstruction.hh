@@ -4,11 +4,14 @@
 
 #include "G4GenericMessenger.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4ThreeVector.hh"
 #include <G4LogicalVolume.hh>
 #include <G4Material.hh>
 #include <G4MaterialPropertiesTable.hh>
+#include <G4Region.hh>
 #include <G4VPhysicalVolume.hh>
 #include <G4VUserDetectorConstruction.hh>
+#include <vector>
 
 // DetectorConstruction 继承自 G4VUserDetectorConstruction
 // 这是 Geant4 中定义几何结构的基类
@@ -23,9 +26,38 @@ public:
   virtual G4VPhysicalVolume *Construct();
   virtual void ConstructSDandField();
 
+  // 每个晶体 hit 的时间分箱能量沉积（0 个箱 = 关闭；箱宽不为正时也关闭，
+  // 与 DetectorSD 一致，RunAction 按它决定是否预订 CrystalTimeBinEdep 列）
+  G4int GetTimeBinCount() const {
+    return fTimeBinCount > 0 && fTimeBinWidth > 0. ? fTimeBinCount : 0;
+  }
+  G4double GetTimeBinWidth() const { return fTimeBinWidth; }
+  G4double GetTimeBinStart() const { return fTimeBinStart; }
+
+  // 晶体外表面的光学模式 (/CsI/detector/surface): none, absorb, detect
+  // （只在开启光学物理时生效）
+  const G4String &GetSurfaceMode() const { return fSurfaceMode; }
+
+  // 晶体中心位置表，按连续晶体索引（Construct() 之后有效）
+  const std::vector<G4ThreeVector> &GetCrystalCentres() const {
+    return fCrystalCentres;
+  }
+
 private:
   G4GenericMessenger *fMessenger;
   G4String fGapMaterial;
+  G4String fOpticalDataDir; // optical_*.txt 数据文件所在目录
+  G4String fSurfaceMode;
+  G4double fSurfaceEfficiency; // detect 模式下到达表面的光子被探测的概率
+  // 快速簇射模式 (/CsI/physics/fastShower)：晶体阵列（Gap 体积）为一个区域，
+  // 其中高于 fFastShowerMinEnergy 的 e-/e+ 用 GFlash 参数化
+  G4double fFastShowerMinEnergy;
+  G4Region *fArrayRegion; // nullptr unless fast showers are enabled
+  G4LogicalVolume *fGapLV; // of the current geometry, nullptr before Construct
+  G4int fTimeBinCount;
+  G4double fTimeBinWidth;
+  G4double fTimeBinStart;
+  std::vector<G4ThreeVector> fCrystalCentres;
   G4Material *fAir;
   G4Material *fOpticalGrease;
   G4Material *fCsI;
@@ -33,6 +65,8 @@ private:
   G4MaterialPropertiesTable *fMptGrease;
   G4MaterialPropertiesTable *fMptCsI;
   void DefineMaterials();
+  void DefineOpticalProperties();
+  void BuildCrystalSurface(G4LogicalVolume *csiLV);
   void SetVisualizationAttributes(G4LogicalVolume *worldLV,
                                   G4LogicalVolume *gapLV,
                                   G4LogicalVolume *csiLV);
@@ -1,14 +1,24 @@
 // DetectorSD.hh
+#ifndef DETECTOR_SD_HH
+#define DETECTOR_SD_HH
 
 #include "G4Allocator.hh"
 #include "G4Step.hh"
 #include "G4THitsCollection.hh"
 #include "G4ThreeVector.hh"
 #include "G4VHit.hh"
+#include "G4VGFlashSensitiveDetector.hh"
 #include "G4VSensitiveDetector.hh"
+#include <algorithm>
+#include <vector>
+
+class TrackingAction;
 
 class CsIHit : public G4VHit {
 public:
+  // 按初级粒子分开的能量沉积；更多的初级粒子并入最后一格
+  static constexpr G4int kMaxPrimaries = 4;
+
   CsIHit();
   virtual ~CsIHit();
   CsIHit(const CsIHit &right);
@@ -36,6 +46,12 @@ public:
   void SetCreatorProcess(const G4String &proc) { fCreatorProcess = proc; }
   void SetTrackLength(G4double len) { fTrackLength = len; }
   void AddTrackLength(G4double len) { fTrackLength += len; }
+  // Time-binned energy history, owned by the hit (copies are independent)
+  void SetTimeBinCount(G4int nBins) { fTimeBins.assign(nBins, 0.f); }
+  void AddTimeBinEdep(G4int bin, G4double de) { fTimeBins[bin] += de; }
+  void AddPrimaryEdep(G4int primary, G4double de) {
+    fPrimaryEdep[std::min(primary, kMaxPrimaries - 1)] += de;
+  }
 
   G4int GetTrackID() const { return fTrackID; }
   G4int GetChamberNb() const { return fChamberNb; }
@@ -48,10 +64,15 @@ public:
   G4double GetKineticEnergy() const { return fKineticEnergy; }
   G4String GetCreatorProcess() const { return fCreatorProcess; }
   G4double GetTrackLength() const { return fTrackLength; }
+  // nullptr if time binning is off
+  const G4float *GetTimeBins() const {
+    return fTimeBins.empty() ? nullptr : fTimeBins.data();
+  }
+  G4double GetPrimaryEdep(G4int primary) const { return fPrimaryEdep[primary]; }
 
 private:
   G4int fTrackID;
-  G4int fChamberNb; // Copy Number
+  G4int fChamberNb; // Copy number = dense crystal index
   G4double fEdep;
   G4ThreeVector fPos;
   G4double fTime;
@@ -61,6 +82,8 @@ private:
   G4double fKineticEnergy;
   G4String fCreatorProcess;
   G4double fTrackLength;
+  std::vector<G4float> fTimeBins; // empty if time binning is off
+  G4double fPrimaryEdep[kMaxPrimaries];
 };
 
 typedef G4THitsCollection<CsIHit> CsIHitsCollection;
@@ -77,16 +100,44 @@ inline void CsIHit::operator delete(void *hit) {
   CsIHitAllocator->FreeSingle((CsIHit *)hit);
 }
 
-class DetectorSD : public G4VSensitiveDetector {
+// 完整模拟的步 (G4Step) 和 GFlash 参数化簇射的能量点 (G4GFlashSpot)
+// 都累加到同一套每晶体一个的 CsIHit 上
+class DetectorSD : public G4VSensitiveDetector,
+                   public G4VGFlashSensitiveDetector {
 public:
-  DetectorSD(const G4String &name, const G4String &hitsCollectionName);
+  // nTimeBins > 0 enables the per-crystal time-binned energy history:
+  // bins of binWidth starting at binStart, the last bin also collects
+  // everything later than the window.
+  DetectorSD(const G4String &name, const G4String &hitsCollectionName,
+             G4int nTimeBins = 0, G4double binWidth = 0.,
+             G4double binStart = 0.);
   virtual ~DetectorSD();
 
   virtual void Initialize(G4HCofThisEvent *hitCollection) override;
   virtual G4bool ProcessHits(G4Step *step,
                              G4TouchableHistory *history) override;
+  virtual G4bool ProcessHits(G4GFlashSpot *spot,
+                             G4TouchableHistory *history) override;
   virtual void EndOfEvent(G4HCofThisEvent *hitCollection) override;
 
+  G4int GetNTimeBins() const { return fNTimeBins; }
+
 private:
+  // 把一次能量沉积加到晶体 index 的 hit 上（没有就新建）
+  void AddDeposit(G4int index, G4double edep, const G4Track *track,
+                  G4double time, const G4ThreeVector &position,
+                  const G4ThreeVector &direction, G4double kineticEnergy,
+                  G4double stepLength);
+
   CsIHitsCollection *fHitsCollection;
+
+  G4int fNTimeBins;
+  G4double fTimeBinWidth;
+  G4double fTimeBinStart;
+  // Position of each crystal's hit in the collection, -1 if none
+  std::vector<G4int> fHitOfCrystal;
+  // Track -> primary table, owned by the TrackingAction of this thread
+  const TrackingAction *fTrackingAction;
 };
+
+#endif
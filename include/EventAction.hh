@@ -3,6 +3,11 @@
 
 #include "G4UserEventAction.hh"
 #include "globals.hh"
+#include <vector>
+
+class CrystalClusterer;
+class CsIDigitizer;
+class WaveformSynthesizer;
 
 class EventAction : public G4UserEventAction {
 public:
@@ -14,6 +19,11 @@ public:
 
 private:
     G4int fHCID;
+    G4int fDCID;
+    CsIDigitizer* fDigitizer; // owned by G4DigiManager
+    WaveformSynthesizer* fWaveform;
+    std::vector<float> fWaveformInput; // binned deposits of one crystal
+    CrystalClusterer* fClusterer;
 };
 
 #endif
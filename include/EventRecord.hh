@@ -0,0 +1,92 @@
+// EventRecord.hh
+#ifndef EVENT_RECORD_HH
+#define EVENT_RECORD_HH
+
+#include "globals.hh"
+#include <utility>
+#include <vector>
+
+// 一个事件在 ntuple 中的一行：标量列和全部 vector 列
+// RunAction 把 vector 列绑定到一个 EventRecord；异步输出时 EventAction
+// 填写另一个 EventRecord，写线程再把它交换进绑定的那个（只交换指针）。
+struct EventRecord {
+  G4int eventID = 0;
+  G4double totalEdep = 0.;
+  G4int hitCount = 0;
+  G4double eventWeight = 1.;
+  G4int watchdogFlags = 0; // EventWatchdog::Flag bits
+  G4int configIndex = 0;   // ParameterSweep configuration
+  G4int truncated = 0;     // 1: vector columns cut at maxHitEntries
+
+  std::vector<int> crystalIDs;     // XXYYZZ, derived from the index
+  std::vector<int> crystalIndices; // dense crystal index 0..N-1
+  std::vector<double> crystalEdeps;
+  std::vector<double> crystalTimes;
+  std::vector<double> crystalPosX;
+  std::vector<double> crystalPosY;
+  std::vector<double> crystalPosZ;
+  std::vector<int> crystalPDGs;
+  std::vector<int> crystalTrackIDs;
+  std::vector<int> crystalParentIDs;
+  std::vector<double> crystalDirX;
+  std::vector<double> crystalDirY;
+  std::vector<double> crystalDirZ;
+  std::vector<double> crystalKineticEnergy;
+  std::vector<int> crystalProcessIDs;
+  std::vector<double> crystalTrackLength;
+  std::vector<float> crystalTimeBinEdeps; // flattened, nTimeBins per hit
+  // flattened, one entry per primary (up to CsIHit::kMaxPrimaries) per hit
+  std::vector<float> crystalPrimaryEdeps;
+
+  // Primary Particle Vectors
+  std::vector<int> primaryPDG;
+  std::vector<double> primaryEnergy;
+  std::vector<double> primaryPosX;
+  std::vector<double> primaryPosY;
+  std::vector<double> primaryPosZ;
+  std::vector<double> primaryDirX;
+  std::vector<double> primaryDirY;
+  std::vector<double> primaryDirZ;
+
+  // Photon Exit Vectors
+  std::vector<int> photonExitCrystalIDs;
+  std::vector<int> photonExitCounts;
+
+  // Digi Vectors
+  std::vector<int> digiCrystalIDs;
+  std::vector<int> digiADCs;
+  std::vector<int> digiTDCs;
+
+  // Waveform Vectors: nSamples consecutive samples per fired crystal
+  std::vector<int> waveformCrystalIDs;
+  std::vector<float> waveformSamples;
+
+  // Cluster Vectors
+  std::vector<double> clusterEnergy;
+  std::vector<double> clusterPosX;
+  std::vector<double> clusterPosY;
+  std::vector<double> clusterPosZ;
+  std::vector<double> clusterTime;
+  std::vector<int> clusterSize;
+  std::vector<int> clusterSeedID; // XXYYZZ of the most energetic crystal
+
+  // Truth Vectors: secondaries above /CsI/truth/minEnergy at creation
+  std::vector<int> truthTrackID;
+  std::vector<int> truthParentID;
+  std::vector<int> truthPDG;
+  std::vector<int> truthProcessID;
+  std::vector<double> truthEnergy;
+  std::vector<double> truthPosX;
+  std::vector<double> truthPosY;
+  std::vector<double> truthPosZ;
+  std::vector<double> truthTime;
+
+  // 清空所有列，保留容量
+  void Clear();
+  // 与另一行交换全部内容
+  void Swap(EventRecord &other);
+  // vector 列分配的字节数 (capacity)
+  G4long Bytes() const;
+};
+
+#endif
@@ -0,0 +1,72 @@
+// EventWatchdog.hh
+#ifndef EVENT_WATCHDOG_HH
+#define EVENT_WATCHDOG_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+
+#include <chrono>
+
+class G4Step;
+class G4Track;
+
+// 每个事件的失控保护 (/CsI/watchdog/)
+// CsI (n = 1.79) 对空气全反射，吸收长度又长，个别光子会反射很久，
+// 少数这样的事件占掉作业的大部分时间。三个上限（0 = 不限制）:
+//   maxPhotonSteps  单条光子径迹的步数，超出的光子被杀掉
+//   maxGlobalTime   任何径迹的全局时间，超出的径迹被杀掉
+//   maxEventTime    单个事件的墙钟时间，超出时中止整个事件
+//                   （已记录的 hit 照常写出）
+// 触发过的上限记在 ntuple 的 WatchdogFlags 列（位掩码），
+// 各线程的计数在 EndOfRunAction 合并，master 打印触发频率。
+class EventWatchdog {
+public:
+  enum Flag {
+    kPhotonSteps = 1 << 0,
+    kGlobalTime = 1 << 1,
+    kWallClock = 1 << 2
+  };
+
+  EventWatchdog();
+  ~EventWatchdog();
+
+  G4bool IsEnabled() const {
+    return fMaxPhotonSteps > 0 || fMaxGlobalTime > 0. || fMaxEventTime > 0.;
+  }
+
+  void BeginEvent();
+  // SteppingAction: 每一步检查上限
+  void CheckStep(const G4Step *step);
+  void EndEvent();
+  // 本事件触发过的上限 (Flag 的组合)
+  G4int GetEventFlags() const { return fEventFlags; }
+
+  // 本线程的计数并入全局并清零；master 打印全局结果
+  void Merge();
+  static void PrintMerged();
+
+  struct Counts {
+    G4long events = 0;
+    G4long flaggedEvents[3] = {0, 0, 0}; // per flag bit
+    G4long killedPhotons = 0;            // maxPhotonSteps
+    G4long killedLateTracks = 0;         // maxGlobalTime
+    G4double maxEventSeconds = 0.;       // slowest event (wall clock)
+  };
+
+private:
+  void Kill(G4Track *track, G4int flag);
+
+  G4GenericMessenger *fMessenger;
+  G4int fMaxPhotonSteps;
+  G4double fMaxGlobalTime;
+  G4double fMaxEventTime; // wall clock, Geant4 time units
+
+  // 当前事件
+  G4int fEventFlags;
+  G4int fStepsSinceClock; // 每 kClockInterval 步读一次时钟
+  std::chrono::steady_clock::time_point fEventStart;
+
+  Counts fCounts;
+};
+
+#endif
@@ -0,0 +1,69 @@
+// MemoryMonitor.hh
+#ifndef MEMORY_MONITOR_HH
+#define MEMORY_MONITOR_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+
+// 每个事件的内存高水位，以及有界内存模式
+// 记录: hit 数、保存的轨迹数、栈中等待的径迹数、ntuple 一行的 vector 字节数、
+// 事件结束时进程的 RSS。各线程在 EndOfRunAction 合并（取最大值），
+// master 在 run 总结中打印。
+//
+// 有界模式 (/CsI/memory/bounded true) 下:
+//   maxTrajectories  每个事件最多创建的轨迹数，超出的径迹不保存轨迹
+//   maxHitEntries    每个事件最多写入 ntuple 的 hit 行（TotalEdep 和
+//                    HitCount 仍包含全部），digi、波形和簇的列同样截断；
+//                    被截断的事件 Truncated 列为 1
+//   basketSize       ntuple 的 basket 大小 (bytes)，满了就写到文件，
+//                    限制未写出的缓冲；在第一次 run booking 时生效
+class MemoryMonitor {
+public:
+  MemoryMonitor();
+  ~MemoryMonitor();
+
+  G4bool IsBounded() const { return fBounded; }
+  // 0 表示不限制
+  G4int GetMaxHitEntries() const { return fBounded ? fMaxHitEntries : 0; }
+  G4int GetBasketSize() const { return fBounded ? fBasketSize : 0; }
+
+  void BeginEvent();
+  // TrackingAction: 是否为这条径迹创建轨迹（有界模式下计数）
+  G4bool AcceptTrajectory();
+  // 当前栈中的径迹数
+  void SampleStack(G4int nTracks) {
+    if (nTracks > fEventStack)
+      fEventStack = nTracks;
+  }
+  void EndEvent(G4int nHits, G4long ntupleBytes, G4bool truncated);
+
+  // 本线程的高水位并入全局并清零；master 打印全局结果
+  void Merge();
+  static void PrintMerged();
+
+  struct HighWater {
+    G4long events = 0;
+    G4long truncatedEvents = 0;     // hit 行被截断的事件
+    G4long droppedTrajectories = 0; // 超出 maxTrajectories 未创建的轨迹
+    G4int hits = 0;
+    G4int trajectories = 0;
+    G4int stackTracks = 0;
+    G4long ntupleBytes = 0;
+    G4long rssKB = 0;
+  };
+
+private:
+  G4GenericMessenger *fMessenger;
+  G4bool fBounded;
+  G4int fMaxTrajectories;
+  G4int fMaxHitEntries;
+  G4int fBasketSize;
+
+  // 当前事件
+  G4int fEventTrajectories;
+  G4int fEventStack;
+
+  HighWater fHighWater;
+};
+
+#endif
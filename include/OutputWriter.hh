@@ -0,0 +1,123 @@
+// OutputWriter.hh
+#ifndef OUTPUT_WRITER_HH
+#define OUTPUT_WRITER_HH
+
+#include "EventRecord.hh"
+#include "g4root.hh" // For Geant4 10.x
+#include "globals.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 单生产者/单消费者的有界无锁环形队列
+// head/tail 单调递增，容量取 2 的幂
+template <typename T> class SPSCQueue {
+public:
+  explicit SPSCQueue(size_t capacity) : fHead(0), fTail(0) {
+    size_t size = 1;
+    while (size < capacity)
+      size <<= 1;
+    fSlots.resize(size);
+    fMask = size - 1;
+  }
+
+  G4bool Push(const T &value) {
+    size_t tail = fTail.load(std::memory_order_relaxed);
+    if (tail - fHead.load(std::memory_order_acquire) > fMask)
+      return false;
+    fSlots[tail & fMask] = value;
+    fTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  G4bool Pop(T &value) {
+    size_t head = fHead.load(std::memory_order_relaxed);
+    if (head == fTail.load(std::memory_order_acquire))
+      return false;
+    value = fSlots[head & fMask];
+    fHead.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t Size() const {
+    return fTail.load(std::memory_order_acquire) -
+           fHead.load(std::memory_order_acquire);
+  }
+
+private:
+  std::vector<T> fSlots;
+  size_t fMask;
+  alignas(64) std::atomic<size_t> fHead; // consumer
+  alignas(64) std::atomic<size_t> fTail; // producer
+};
+
+// 异步 ntuple 输出 (/CsI/output/async true)
+// 每个 worker 一个写线程。EventAction 填写从空闲队列取得的 EventRecord，
+// 填完后放入待写队列；写线程把它交换进绑定到 ntuple 列的那一行，
+// 填直方图（fillHistograms）并调用本 worker 的 AddNtupleRow（压缩和
+// 文件 I/O 都在写线程），再把清空的 EventRecord 放回空闲队列。
+// run 期间本 worker 的 analysis manager 只由写线程调用。
+// 两个队列都是 SPSC 无锁队列，EventRecord 总数 = queueDepth。
+// 队列空/满时在条件变量上等待：写线程等新的行，
+// 写线程跟不上时 Acquire() 等待空闲行（背压），等待次数和时间计入统计。
+class OutputWriter {
+public:
+  // bound: 绑定到 ntuple 列的行，此后只由写线程访问
+  // fillHistograms: 写线程在写出每一行之前调用（可以为空）
+  using HistogramFiller =
+      std::function<void(G4AnalysisManager *, const EventRecord &)>;
+  OutputWriter(G4int depth, EventRecord *bound,
+               HistogramFiller fillHistograms = nullptr);
+  ~OutputWriter();
+
+  // 必须在 worker 线程调用：记录本线程的 analysis manager
+  void Start();
+  // 写完队列中的所有行后结束写线程，打印队列统计
+  void Stop();
+
+  // EventAction 侧
+  EventRecord *Acquire();
+  void Push(EventRecord *record);
+  // 所有行（队列中的、空闲的、正在填写的和 bound）的 vector 列占用的字节数
+  // 只在 worker 线程调用
+  G4long Bytes() const;
+
+private:
+  void Run();
+  void Write(EventRecord *record);
+
+  G4int fDepth;
+  EventRecord *fBound;
+  HistogramFiller fFillHistograms;
+  G4AnalysisManager *fAnalysisManager;
+  std::vector<std::unique_ptr<EventRecord>> fRecords;
+  SPSCQueue<EventRecord *> fPending; // worker -> writer
+  SPSCQueue<EventRecord *> fFree;    // writer -> worker
+  std::thread fThread;
+  std::atomic<G4bool> fStop;
+  // 队列空（写线程）或没有空闲行（worker）时等待；状态由队列本身给出，
+  // 锁只用来避免丢失唤醒
+  std::mutex fMutex;
+  std::condition_variable fPendingReady;
+  std::condition_variable fFreeReady;
+
+  // 行的容量只在 worker 填写时增长（Swap 和 Clear 不改变总容量），
+  // 所以总量由 worker 在 Push() 时累计，不需要读写线程持有的行
+  G4long fBytes;
+  EventRecord *fHeld; // Acquire() 之后、Push() 之前
+  G4long fHeldBytes;  // fHeld 在 Acquire() 时的字节数
+
+  // 队列统计（worker 侧）
+  G4long fRows;
+  G4long fStalls;
+  G4double fStallSeconds;
+  size_t fMaxDepth;
+  G4double fDepthSum;
+};
+
+#endif
@@ -0,0 +1,56 @@
+// ParameterSweep.hh
+#ifndef PARAMETER_SWEEP_HH
+#define PARAMETER_SWEEP_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+
+#include <vector>
+
+// 参数扫描 (/CsI/sweep/)：在一个已初始化的进程中依次运行一组配置
+//   /CsI/sweep/add /CsI/detector/gapMaterial Air, OpticalGrease
+//   /CsI/sweep/add /CsI/generator/particleEnergy 1 MeV, 4 MeV, 10 MeV
+//   /CsI/sweep/beamOn 10000
+// 每个 add 声明一个轴（UI 命令和逗号分隔的取值），配置是各轴取值的
+// 全部组合，每个配置一个 run，事件数相同。两个 run 之间只执行取值变了的
+// 命令。/CsI/detector/ 下的命令是几何参数：这些轴排在最外层，只有它们的
+// 值真正改变时才重建几何（物理表只为新的材料重新计算）。
+// 所有配置写到同一个输出文件，ntuple 的 ConfigIndex 列是配置编号，
+// 编号与取值的对应写到 <fileName>_SweepConfigs.txt；直方图累加全部配置。
+// 扫描期间不写检查点。需要顺序模式（G4RunManager），与 Checkpoint 相同。
+class ParameterSweep {
+public:
+  // outputName: RunAction 的 /CsI/output/fileName（不含扩展名）
+  explicit ParameterSweep(const G4String &outputName);
+  ~ParameterSweep();
+
+  // 当前 run 属于一次扫描：输出文件在第一个配置打开，最后一个配置之后关闭
+  G4bool IsRunning() const { return fRunning; }
+  G4bool IsFirstConfig() const { return fConfigIndex == 0; }
+  G4bool IsLastConfig() const { return fConfigIndex == fConfigCount - 1; }
+  // ntuple 的 ConfigIndex 列（不在扫描中时为 0）
+  G4int GetConfigIndex() const { return fRunning ? fConfigIndex : 0; }
+
+private:
+  struct Axis {
+    G4String command;
+    std::vector<G4String> values;
+    G4bool geometry; // /CsI/detector/...
+  };
+
+  void AddAxis(const G4String &commandAndValues);
+  void Clear();
+  void BeamOn(G4int nEvents);
+  void WriteConfigTable(const std::vector<Axis> &axes) const;
+
+  G4GenericMessenger *fMessenger;
+  const G4String &fOutputName;
+  std::vector<Axis> fAxes;
+
+  // 当前扫描
+  G4bool fRunning;
+  G4int fConfigIndex;
+  G4int fConfigCount;
+};
+
+#endif
@@ -4,6 +4,7 @@
 
 #include "G4GenericMessenger.hh"
 #include "G4VModularPhysicsList.hh"
+#include <chrono>
 
 class PhysicsList : public G4VModularPhysicsList {
 public:
@@ -11,9 +12,33 @@ public:
   virtual ~PhysicsList();
 
   void SetOpticalPhysics(G4bool on);
+  // 材料的光学属性表只在开启光学物理时构建
+  G4bool IsOpticalEnabled() const { return fOpticalEnabled; }
+
+  // e-/e+ 的快速模拟过程；参数化簇射模型由 DetectorConstruction
+  // 挂在晶体阵列区域上
+  void SetFastShowerPhysics(G4bool on);
+  G4bool IsFastShowerEnabled() const { return fFastShowerEnabled; }
+
+  // 物理表缓存目录：/run/initialize 时若目录中有与本配置匹配的表就读取，
+  // 否则正常计算，并在第一次 run 开始后写入该目录下本配置的子目录
+  void SetTableDirectory(const G4String &dir);
+  virtual void SetCuts() override;
+  // master，第一次 BeginOfRunAction（物理表已建好）：写出物理表，打印启动时间
+  // 服务模式在 fork 请求之前的空 run 之后调用；只执行一次
+  void EndOfStartup();
 
 private:
+  G4String TableStamp() const;
+
   G4GenericMessenger *fMessenger;
+  G4bool fOpticalEnabled;
+  G4bool fFastShowerEnabled;
+  G4String fTableDir;
+  G4String fTablePath; // fTableDir 下本配置的子目录
+  G4bool fStoreTables;
+  G4bool fStartupDone;
+  std::chrono::steady_clock::time_point fConstructionTime;
 };
 
 #endif
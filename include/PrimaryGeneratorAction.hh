@@ -1,12 +1,18 @@
 #ifndef PRIMARY_GENERATOR_ACTION_HH
 #define PRIMARY_GENERATOR_ACTION_HH
 
-#include "G4GeneralParticleSource.hh"
+#include "BiasedSampler.hh"
 #include "G4GenericMessenger.hh"
-#include <G4ParticleGun.hh>
+#include "G4ThreeVector.hh"
 #include <G4VUserPrimaryGeneratorAction.hh>
+#include <map>
 #include <vector>
 
+class VPrimaryGenerator;
+class GammaLineGenerator;
+class VertexFileGenerator;
+class MappedVertexGenerator;
+
 class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction {
 public:
   PrimaryGeneratorAction();
@@ -14,23 +20,51 @@ public:
 
   virtual void GeneratePrimaries(G4Event *event) override;
 
+  // 模式在设置时解析为生成器对象，未知模式保留原设置
+  void SetMode(const G4String &mode);
+
 private:
-  G4ParticleGun *fParticleGun;
   G4GenericMessenger *fMessenger;
   G4GenericMessenger *fRandMessenger;
+  G4GenericMessenger *fBiasMessenger;
 
   // Configurable parameters
   G4double fMaxEnergy;
-  G4String fMode;           // "ePair", "ePairOpposite", "ePairDeflected"
-  G4double fDeflectAngle;   // in degrees for deflected two-particle mode
-  G4double fParticleEnergy; // energy for generated particles (MeV)
+  G4String fMode;
+  G4double fDeflectAngle;   // deflected two-particle mode
+  G4double fParticleEnergy; // gammaLine default energy, axion total energy
+  G4double fAxionMass;
+  G4long fFirstEntry; // vertexBinary: entry used for event 0
   // Random seed control
   G4bool fAutoSeed;
   G4long fSeed;
 
-  // Cached particle definitions
-  G4ParticleDefinition *fElectron;
-  G4ParticleDefinition *fPositron;
+  // Importance sampling of vertex position and energy (/CsI/bias/)
+  BiasedSampler fSampler;
+  G4String fEnergyPDFFile; // 当前能量 PDF，maxEnergy 改变时重新截断
+
+  // Generator strategies: owned list, mode name (and aliases) -> generator
+  std::vector<VPrimaryGenerator *> fGenerators;
+  std::map<G4String, VPrimaryGenerator *> fModes;
+  VPrimaryGenerator *fGenerator; // current mode
+  GammaLineGenerator *fGammaLines;
+  VertexFileGenerator *fVertexFile;
+  MappedVertexGenerator *fMappedVertices;
+
+  void RegisterMode(const G4String &name, VPrimaryGenerator *generator);
+  void AddGammaLine(const G4String &energyAndIntensity);
+  void ClearGammaLines();
+  void LoadVertexFile(const G4String &fileName);
+  void MapVertexFile(const G4String &fileName);
+  void SetMaxEnergy(G4double maxEnergy);
+  // 无效的值被拒绝并保留原值，AxionDecayGenerator 不再检查
+  void SetParticleEnergy(G4double energy);
+  void SetAxionMass(G4double mass);
+  void LoadEnergyPDF(const G4String &fileName);
+  void LoadBoundaryPDF(const G4String &fileName);
+  void ClearBias();
+  // weight *= p/q of the position sampling
+  G4ThreeVector SampleVertex(G4double &weight) const;
 
   // CsI晶体阵列参数，再次声明或传入
   G4int fNx, fNy, fNz;
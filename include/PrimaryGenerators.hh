@@ -0,0 +1,167 @@
+// PrimaryGenerators.hh
+#ifndef PRIMARY_GENERATORS_HH
+#define PRIMARY_GENERATORS_HH
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+#include <cstdint>
+#include <vector>
+
+class BiasedSampler;
+class G4Event;
+class G4ParticleDefinition;
+class G4PrimaryVertex;
+
+// 初级粒子生成策略
+// 每种 /CsI/generator/mode 对应一个生成器对象，模式在设置时解析一次，
+// 每个事件只做一次虚函数调用；生成器直接构造 G4PrimaryVertex /
+// G4PrimaryParticle，不经过 G4ParticleGun。
+// 参数由 PrimaryGeneratorAction 的 messenger 持有，生成器只保存引用。
+class VPrimaryGenerator {
+public:
+  virtual ~VPrimaryGenerator() {}
+
+  // vertexPos: 在随机晶体内均匀抽样的位置（UsesSampledVertex() 为 false 时
+  // 不抽样，传入原点）
+  virtual void Generate(G4Event *event, const G4ThreeVector &vertexPos) = 0;
+  virtual G4bool UsesSampledVertex() const { return true; }
+
+protected:
+  static void AddParticle(G4PrimaryVertex *vertex,
+                          G4ParticleDefinition *particle, G4double energy,
+                          const G4ThreeVector &direction);
+};
+
+// e-/e+ 共顶点背对背发射，动能均匀分布在 [0, maxEnergy]
+// （设置了能量偏置时按偏置密度抽样，顶点权重为 p/q）
+class PairGenerator : public VPrimaryGenerator {
+public:
+  PairGenerator(const G4double &maxEnergy, const BiasedSampler &sampler);
+  void Generate(G4Event *event, const G4ThreeVector &vertexPos) override;
+
+private:
+  const G4double &fMaxEnergy;
+  const BiasedSampler &fSampler;
+  G4ParticleDefinition *fElectron;
+  G4ParticleDefinition *fPositron;
+};
+
+// e-/e+ 相对随机轴各偏转 deflectAngle
+class DeflectedPairGenerator : public VPrimaryGenerator {
+public:
+  DeflectedPairGenerator(const G4double &maxEnergy,
+                         const G4double &deflectAngle,
+                         const BiasedSampler &sampler);
+  void Generate(G4Event *event, const G4ThreeVector &vertexPos) override;
+
+private:
+  const G4double &fMaxEnergy;
+  const BiasedSampler &fSampler;
+  const G4double &fDeflectAngle;
+  G4ParticleDefinition *fElectron;
+  G4ParticleDefinition *fPositron;
+};
+
+// 各向同性单能 gamma，按强度从已登记的谱线中抽取一条；
+// 没有登记谱线时使用 particleEnergy
+class GammaLineGenerator : public VPrimaryGenerator {
+public:
+  GammaLineGenerator(const G4double &defaultEnergy);
+  void Generate(G4Event *event, const G4ThreeVector &vertexPos) override;
+
+  void AddLine(G4double energy, G4double intensity);
+  void ClearLines();
+
+private:
+  const G4double &fDefaultEnergy;
+  G4ParticleDefinition *fGamma;
+  std::vector<G4double> fEnergies;
+  std::vector<G4double> fCumulative; // cumulative intensity
+};
+
+// 类轴子粒子 a -> gamma gamma
+// 静止系中两光子各 m/2 背对背各向同性，再沿随机方向推进到总能量
+// particleEnergy。质量必须为正，总能量不能小于质量（等于质量即静止衰变），
+// 否则 Generate 抛出 G4Exception (FatalErrorInArgument)
+// 质量和总能量由 PrimaryGeneratorAction 的 setter 检查（m > 0, E >= m）
+class AxionDecayGenerator : public VPrimaryGenerator {
+public:
+  AxionDecayGenerator(const G4double &mass, const G4double &totalEnergy);
+  void Generate(G4Event *event, const G4ThreeVector &vertexPos) override;
+
+private:
+  const G4double &fMass;
+  const G4double &fTotalEnergy;
+  G4ParticleDefinition *fGamma;
+};
+
+// 从文本文件读取顶点列表，事件 i 取文件中第 (eventID mod N) 个事件
+// 文件格式（# 开头为注释，每行一个粒子，同一事件号的行组成一个事件，
+// 同一事件内位置和时间相同的粒子共用一个顶点）:
+//   event PDG x[mm] y[mm] z[mm] t[ns] px[MeV] py[MeV] pz[MeV]
+class VertexFileGenerator : public VPrimaryGenerator {
+public:
+  VertexFileGenerator();
+  void Generate(G4Event *event, const G4ThreeVector &vertexPos) override;
+  G4bool UsesSampledVertex() const override { return false; }
+
+  // 返回读入的事件数，失败时为 0
+  G4int Load(const G4String &fileName);
+
+private:
+  struct Particle {
+    G4int pdg;
+    G4ThreeVector position;
+    G4double time;
+    G4ThreeVector momentum;
+  };
+  std::vector<Particle> fParticles;
+  std::vector<size_t> fEventOffsets; // first particle of each event + end
+};
+
+// 内存映射的二进制顶点文件（由 vertex_file.py 生成），文件不整体读入内存，
+// 只有被访问的页由内核按需载入，多个线程映射同一文件时共享页缓存。
+// 事件 i 取第 (firstEntry + eventID) mod N 个事件：事件号在各 worker 之间
+// 互不重复，所以各线程读取的条目互不相交，也不需要锁。
+//
+// 布局（小端）:
+//   Header                      (32 bytes)
+//   uint64 offsets[nEvents + 1] (每个事件第一个粒子的序号，最后一个为总数)
+//   Record records[nParticles]  (64 bytes each)
+// 单位: mm, ns, MeV。同一事件内位置和时间相同的粒子共用一个顶点，
+// 顶点权重取该顶点第一个粒子的 weight。
+class MappedVertexGenerator : public VPrimaryGenerator {
+public:
+  struct Header {
+    char magic[8]; // "CSIVTX01"
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint64_t nEvents;
+    std::uint64_t nParticles;
+  };
+  struct Record {
+    double x, y, z, t;
+    double px, py, pz;
+    float weight;
+    std::int32_t pdg;
+  };
+
+  MappedVertexGenerator(const G4long &firstEntry);
+  ~MappedVertexGenerator();
+  void Generate(G4Event *event, const G4ThreeVector &vertexPos) override;
+  G4bool UsesSampledVertex() const override { return false; }
+
+  // 返回文件中的事件数，失败时为 0
+  G4long Open(const G4String &fileName);
+  void Close();
+
+private:
+  const G4long &fFirstEntry;
+  void *fMap;
+  size_t fMapSize;
+  std::uint64_t fNEvents;
+  const std::uint64_t *fOffsets;
+  const Record *fRecords;
+};
+
+#endif
@@ -1,12 +1,20 @@
 #ifndef RunAction_h
 #define RunAction_h 1
 
+#include "G4GenericMessenger.hh"
+#include "Checkpoint.hh"
+#include "EventRecord.hh"
+#include "EventWatchdog.hh"
 #include "G4UserRunAction.hh"
+#include "MemoryMonitor.hh"
+#include "ParameterSweep.hh"
 // #include "G4AnalysisManager.hh" // For Geant4 11+
 #include "g4root.hh" // For Geant4 10.x
 #include "globals.hh"
 #include <map>
 
+class OutputWriter;
+
 class RunAction : public G4UserRunAction {
 public:
   RunAction();
@@ -15,74 +23,156 @@ public:
   virtual void BeginOfRunAction(const G4Run *);
   virtual void EndOfRunAction(const G4Run *);
 
-  std::vector<int> &GetCrystalIDs() { return fCrystalIDs; }
-  std::vector<double> &GetCrystalEdeps() { return fCrystalEdeps; }
-  std::vector<double> &GetCrystalTimes() { return fCrystalTimes; }
-  std::vector<double> &GetCrystalPosX() { return fCrystalPosX; }
-  std::vector<double> &GetCrystalPosY() { return fCrystalPosY; }
-  std::vector<double> &GetCrystalPosZ() { return fCrystalPosZ; }
-  std::vector<int> &GetCrystalPDGs() { return fCrystalPDGs; }
-  std::vector<int> &GetCrystalTrackIDs() { return fCrystalTrackIDs; }
-  std::vector<int> &GetCrystalParentIDs() { return fCrystalParentIDs; }
-  std::vector<double> &GetCrystalDirX() { return fCrystalDirX; }
-  std::vector<double> &GetCrystalDirY() { return fCrystalDirY; }
-  std::vector<double> &GetCrystalDirZ() { return fCrystalDirZ; }
+  std::vector<int> &GetCrystalIDs() { return fFill->crystalIDs; }
+  std::vector<int> &GetCrystalIndices() { return fFill->crystalIndices; }
+  std::vector<double> &GetCrystalEdeps() { return fFill->crystalEdeps; }
+  std::vector<double> &GetCrystalTimes() { return fFill->crystalTimes; }
+  std::vector<double> &GetCrystalPosX() { return fFill->crystalPosX; }
+  std::vector<double> &GetCrystalPosY() { return fFill->crystalPosY; }
+  std::vector<double> &GetCrystalPosZ() { return fFill->crystalPosZ; }
+  std::vector<int> &GetCrystalPDGs() { return fFill->crystalPDGs; }
+  std::vector<int> &GetCrystalTrackIDs() { return fFill->crystalTrackIDs; }
+  std::vector<int> &GetCrystalParentIDs() { return fFill->crystalParentIDs; }
+  std::vector<double> &GetCrystalDirX() { return fFill->crystalDirX; }
+  std::vector<double> &GetCrystalDirY() { return fFill->crystalDirY; }
+  std::vector<double> &GetCrystalDirZ() { return fFill->crystalDirZ; }
   std::vector<double> &GetCrystalKineticEnergy() {
-    return fCrystalKineticEnergy;
+    return fFill->crystalKineticEnergy;
+  }
+  std::vector<int> &GetCrystalProcessIDs() { return fFill->crystalProcessIDs; }
+  std::vector<double> &GetCrystalTrackLength() { return fFill->crystalTrackLength; }
+  std::vector<float> &GetCrystalTimeBinEdeps() {
+    return fFill->crystalTimeBinEdeps;
+  }
+  std::vector<float> &GetCrystalPrimaryEdeps() {
+    return fFill->crystalPrimaryEdeps;
   }
-  std::vector<int> &GetCrystalProcessIDs() { return fCrystalProcessIDs; }
-  std::vector<double> &GetCrystalTrackLength() { return fCrystalTrackLength; }
 
   // Primary Particle Getters
-  std::vector<int> &GetPrimaryPDG() { return fPrimaryPDG; }
-  std::vector<double> &GetPrimaryEnergy() { return fPrimaryEnergy; }
-  std::vector<double> &GetPrimaryPosX() { return fPrimaryPosX; }
-  std::vector<double> &GetPrimaryPosY() { return fPrimaryPosY; }
-  std::vector<double> &GetPrimaryPosZ() { return fPrimaryPosZ; }
-  std::vector<double> &GetPrimaryDirX() { return fPrimaryDirX; }
-  std::vector<double> &GetPrimaryDirY() { return fPrimaryDirY; }
-  std::vector<double> &GetPrimaryDirZ() { return fPrimaryDirZ; }
+  std::vector<int> &GetPrimaryPDG() { return fFill->primaryPDG; }
+  std::vector<double> &GetPrimaryEnergy() { return fFill->primaryEnergy; }
+  std::vector<double> &GetPrimaryPosX() { return fFill->primaryPosX; }
+  std::vector<double> &GetPrimaryPosY() { return fFill->primaryPosY; }
+  std::vector<double> &GetPrimaryPosZ() { return fFill->primaryPosZ; }
+  std::vector<double> &GetPrimaryDirX() { return fFill->primaryDirX; }
+  std::vector<double> &GetPrimaryDirY() { return fFill->primaryDirY; }
+  std::vector<double> &GetPrimaryDirZ() { return fFill->primaryDirZ; }
 
   // Photon Exit Getters
-  std::vector<int> &GetPhotonExitCrystalIDs() {
-    G4cout << "Accessing PhotonExitCrystalIDs\n";
-    G4cout << fPhotonExitCounts.size() << G4endl;
-    return fPhotonExitCrystalIDs;
-  }
-  std::vector<int> &GetPhotonExitCounts() { return fPhotonExitCounts; }
+  std::vector<int> &GetPhotonExitCrystalIDs() { return fFill->photonExitCrystalIDs; }
+  std::vector<int> &GetPhotonExitCounts() { return fFill->photonExitCounts; }
+
+  // Digi Getters
+  std::vector<int> &GetDigiCrystalIDs() { return fFill->digiCrystalIDs; }
+  std::vector<int> &GetDigiADCs() { return fFill->digiADCs; }
+  std::vector<int> &GetDigiTDCs() { return fFill->digiTDCs; }
+
+  // Waveform Getters
+  std::vector<int> &GetWaveformCrystalIDs() { return fFill->waveformCrystalIDs; }
+  std::vector<float> &GetWaveformSamples() { return fFill->waveformSamples; }
+
+  // Cluster Getters
+  std::vector<double> &GetClusterEnergy() { return fFill->clusterEnergy; }
+  std::vector<double> &GetClusterPosX() { return fFill->clusterPosX; }
+  std::vector<double> &GetClusterPosY() { return fFill->clusterPosY; }
+  std::vector<double> &GetClusterPosZ() { return fFill->clusterPosZ; }
+  std::vector<double> &GetClusterTime() { return fFill->clusterTime; }
+  std::vector<int> &GetClusterSize() { return fFill->clusterSize; }
+  std::vector<int> &GetClusterSeedID() { return fFill->clusterSeedID; }
+
+  // 整行的 EventRecord（Truth* 列由 EventAction 从 TruthRecord 整体复制）
+  EventRecord &GetRow() { return *fFill; }
 
   int GetProcessID(const G4String &processName);
 
+  // Output mode as booked at the first run (/CsI/output/)
+  G4bool IsNtupleEnabled() const { return fNtupleBooked; }
+  G4bool IsHistogramEnabled() const { return fHistogramsBooked; }
+  G4bool IsHitColumnsEnabled() const {
+    return fNtupleBooked && fHitColumnsBooked;
+  }
+  // nTimeBins floats per hit in CrystalTimeBinEdep (0 if not written)
+  G4int GetTimeBinCount() const { return fTimeBinsBooked; }
+  G4bool IsDigiEnabled() const { return fNtupleBooked && fDigisBooked; }
+  G4bool IsWaveformEnabled() const {
+    return fNtupleBooked && fWaveformsBooked;
+  }
+  G4bool IsClusterEnabled() const { return fNtupleBooked && fClustersBooked; }
+  G4bool IsTruthEnabled() const { return fNtupleBooked && fTruthBooked; }
+  // 每个事件: BeginRow() 之后才能用上面的 vector 引用，
+  // EndRow() 发布到共享内存流（如果打开），填直方图并写出一行（同步）
+  // 或交给写线程（/CsI/output/async）
+  void BeginRow();
+  // hitCount: 全部有能量沉积的 hit；truncated: vector 列被截断
+  void EndRow(G4int eventID, G4double totalEdep, G4int hitCount,
+              G4double weight, G4bool truncated);
+
+  // 事件结束后（EndRow 之后）：到了检查点就关闭当前 part 并保存状态
+  void CheckpointIfDue(G4int eventID);
+  // 续跑时 EventID 的偏移（PrimaryGeneratorAction 加到 G4Event 上）
+  G4int GetEventOffset() const { return fCheckpoint.GetEventOffset(); }
+
+  MemoryMonitor &GetMemoryMonitor() { return fMemoryMonitor; }
+  EventWatchdog &GetWatchdog() { return fWatchdog; }
+  // Bytes held by the vector columns of the current row, or of all rows of
+  // the output writer in async mode
+  G4long GetNtupleRowBytes() const;
+
 private:
-  std::vector<int> fCrystalIDs;
-  std::vector<double> fCrystalEdeps;
-  std::vector<double> fCrystalTimes;
-  std::vector<double> fCrystalPosX;
-  std::vector<double> fCrystalPosY;
-  std::vector<double> fCrystalPosZ;
-  std::vector<int> fCrystalPDGs;
-  std::vector<int> fCrystalTrackIDs;
-  std::vector<int> fCrystalParentIDs;
-  std::vector<double> fCrystalDirX;
-  std::vector<double> fCrystalDirY;
-  std::vector<double> fCrystalDirZ;
-  std::vector<double> fCrystalKineticEnergy;
-  std::vector<int> fCrystalProcessIDs;
-  std::vector<double> fCrystalTrackLength;
-
-  // Primary Particle Vectors
-  std::vector<int> fPrimaryPDG;
-  std::vector<double> fPrimaryEnergy;
-  std::vector<double> fPrimaryPosX;
-  std::vector<double> fPrimaryPosY;
-  std::vector<double> fPrimaryPosZ;
-  std::vector<double> fPrimaryDirX;
-  std::vector<double> fPrimaryDirY;
-  std::vector<double> fPrimaryDirZ;
-
-  // Photon Exit Vectors
-  std::vector<int> fPhotonExitCrystalIDs;
-  std::vector<int> fPhotonExitCounts;
+  void BookNtuple();
+  // Fill the online histograms from one row, weighted by the
+  // importance-sampling event weight (on the writer thread in async mode)
+  void FillHistograms(G4AnalysisManager *analysisManager,
+                      const EventRecord &row);
+  void BookHitColumns();
+  void BookHistograms();
+  void PrintHistogramSummary() const;
+
+  G4GenericMessenger *fMessenger;
+  MemoryMonitor fMemoryMonitor;
+  EventWatchdog fWatchdog;
+  G4bool fWriteNtuple;     // per-hit ntuple "CsI"
+  G4bool fWriteHistograms; // online 1D/2D histograms
+  G4bool fWriteHitColumns; // per-hit MC truth columns (Crystal*)
+  G4bool fWriteDigis;      // digitized ADC/TDC columns (Digi*)
+  G4bool fWriteWaveforms;  // synthesized pulse samples (Waveform*)
+  G4bool fWriteClusters;   // reconstructed crystal clusters (Cluster*)
+  G4bool fWriteTruth;      // significant secondaries (Truth*)
+  G4bool fAsyncOutput;     // ntuple rows written by a separate thread
+  G4int fQueueDepth;       // rows in flight between worker and writer
+  G4String fOutputFileName; // without extension
+  Checkpoint fCheckpoint;  // uses fOutputFileName, declared after it
+  ParameterSweep fSweep;   // likewise
+  G4String fShmName;       // shared-memory event stream (empty = off)
+  G4int fShmSlots;
+  G4int fShmSlotBytes;
+  OutputWriter *fWriter;   // only while a run with async output is active
+  G4bool fBooked;          // booking is done once, at the first run
+  G4bool fNtupleBooked;
+  G4bool fHistogramsBooked;
+  G4bool fHitColumnsBooked;
+  G4bool fDigisBooked;
+  G4bool fWaveformsBooked;
+  G4bool fClustersBooked;
+  G4bool fTruthBooked;
+  G4int fTimeBinsBooked;
+  G4double fHistEmax;      // upper edge of the energy histograms
+  G4double fHistTmax;      // upper edge of the time histogram
+
+  // Histogram IDs (valid only if fWriteHistograms)
+  G4int fH1TotalEdep;
+  G4int fH1HitCount;
+  G4int fH1CrystalEdep;
+  G4int fH1CrystalTime;
+  G4int fH1PhotonExitTotal;
+  std::vector<G4int> fH2Occupancy;  // per z layer, ix vs iy, hit counts
+  std::vector<G4int> fH2EdepMap;    // per z layer, ix vs iy, weighted by edep
+  std::vector<G4int> fH2PhotonExit; // per z layer, weighted by photon count
+
+  // 绑定到 ntuple 列的一行；fFill 是 EventAction 正在填写的一行
+  // （同步输出时就是 fRow，异步输出时是从写线程取得的空行）
+  EventRecord fRow;
+  EventRecord *fFill;
 
   std::map<G4String, int> fProcessMap;
 };
@@ -0,0 +1,100 @@
+// ShmEventSink.hh
+#ifndef SHM_EVENT_SINK_HH
+#define SHM_EVENT_SINK_HH
+
+#include "EventRecord.hh"
+#include "globals.hh"
+
+#include <atomic>
+#include <cstdint>
+
+// 把每个事件的扁平 hit 数组发布到 POSIX 共享内存环形缓冲区
+// (/CsI/output/shmName)，供本机的在线监视程序零拷贝读取 (shm_consumer.py)。
+// 布局见 SHM_STREAM_README.md；所有整数为小端，偏移相对段首。
+//
+//   [ShmHeader, 4096 bytes][slot 0][slot 1]...[slot nSlots-1]
+//   slot: [ShmSlotHeader][CrystalEdep f64][CrystalTime f64][CrystalID i32]
+//         [PhotonExitCrystalID i32][PhotonExitCount i32]
+//
+// 写入方（所有 worker 线程）用 writeIndex 的 fetch_add 领取序号 n，
+// 写入第 n % nSlots 个槽，槽内用 seqlock 保护：seq 为奇数表示正在写。
+// 读取方按序号读槽，复制前后 seq 相同且槽内 index == n 才有效。
+// 读取方可以把 stopRequested 置 1，各 worker 在下一个事件结束时中止 run。
+namespace ShmLayout {
+constexpr char kMagic[8] = {'C', 'S', 'I', 'S', 'H', 'M', '0', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr uint64_t kHeaderBytes = 4096;
+
+enum Column {
+  kCrystalEdep,
+  kCrystalTime,
+  kCrystalID,
+  kPhotonExitCrystalID,
+  kPhotonExitCount,
+  kNColumns
+};
+
+// slot flags
+// hit 数组超出槽容量（或已被 maxHitEntries 截断），只有前面部分
+constexpr uint32_t kTruncated = 1;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t nSlots;
+  uint64_t slotBytes;
+  uint64_t dataOffset;
+  std::atomic<uint64_t> writeIndex; // events claimed so far
+  std::atomic<uint32_t> stopRequested;
+  int32_t runID;
+};
+
+struct SlotHeader {
+  std::atomic<uint64_t> seq; // odd while the slot is being written
+  uint64_t index;            // stream sequence number of this event
+  int32_t eventID;
+  uint32_t nHits;
+  double totalEdep;
+  double eventWeight;
+  uint32_t nPhotonExit;
+  uint32_t flags;
+  uint32_t offsets[kNColumns]; // column block offsets from the slot start
+};
+
+// 列块从这里开始（8 字节对齐）
+constexpr uint64_t kSlotHeaderBytes = (sizeof(SlotHeader) + 7) & ~7ULL;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared-memory counters must be lock-free");
+} // namespace ShmLayout
+
+class ShmEventSink {
+public:
+  // 每个进程一个共享内存段，所有线程共用
+  static ShmEventSink &Instance();
+
+  // 打开（或按新的参数重建）共享内存段；name 为空时关闭
+  void Open(const G4String &name, G4int nSlots, G4int slotBytes);
+  G4bool IsOpen() const { return fHeader != nullptr; }
+  // 新 run 开始（master）：记录 run 号并清除中止请求
+  void SetRunID(G4int runID);
+
+  // 发布一个事件；槽正在被另一个线程写（环绕太快）时丢弃并计数
+  void Publish(const EventRecord &record);
+  G4bool StopRequested() const;
+
+private:
+  ShmEventSink();
+  ~ShmEventSink();
+  void Close();
+
+  G4String fName;
+  G4int fNSlots;
+  G4int fSlotBytes;
+  size_t fSize;
+  char *fBase;
+  ShmLayout::Header *fHeader;
+  std::atomic<G4long> fDropped;
+};
+
+#endif
@@ -0,0 +1,40 @@
+// SimulationService.hh
+#ifndef SIMULATION_SERVICE_HH
+#define SIMULATION_SERVICE_HH
+
+#include "globals.hh"
+#include <vector>
+
+// 服务模式：内核只初始化一次，然后依次执行 spool 目录中的请求
+//   CsI_Axion --service <spoolDir> [init.mac]
+// 请求是 spool 目录中的 <name>.mac 宏文件（先写临时文件再改名放入），
+// 内容为生成器、随机数种子、/CsI/output/ 开关和 /run/beamOn 等命令。
+// 多个服务进程可以共用一个 spool 目录：谁先把 <name>.mac 改名为
+// <name>.mac.running 谁执行。输出写到 <spoolDir>/<name>.root，
+// 结束后请求改名为 <name>.mac.done 或 <name>.mac.failed。
+// 每个请求在 fork 出的子进程中执行：子进程继承已初始化的内核和物理表，
+// 请求设置的生成器、输出开关等状态随子进程结束，不会带到下一个请求；
+// 输出的 booking 也在每个请求的第一次 run 按它自己的开关进行。
+// 请求不能设置 /CsI/output/fileName。请求中任何一条命令失败、没有写出
+// <name>.root 或子进程异常退出都算失败。
+// spool 目录中出现 STOP 文件时所有服务进程在当前请求结束后退出。
+class SimulationService {
+public:
+  explicit SimulationService(const G4String &spoolDir);
+
+  // 构建物理表（fork 之前，子进程共用），然后处理请求直到出现 STOP 文件
+  void Run();
+
+private:
+  // 按文件名排序的待处理请求（不含 .mac 后缀）
+  std::vector<G4String> ListRequests() const;
+  G4bool Claim(const G4String &name) const;
+  G4bool Execute(const G4String &name) const;
+  // 子进程：逐条执行请求宏，返回第一条失败命令之前是否全部成功
+  G4bool ExecuteMacro(const G4String &fileName) const;
+  G4String Path(const G4String &fileName) const;
+
+  G4String fSpoolDir;
+};
+
+#endif
@@ -0,0 +1,76 @@
+// StepStatistics.hh
+#ifndef STEP_STATISTICS_HH
+#define STEP_STATISTICS_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+class G4LogicalVolume;
+class G4ParticleDefinition;
+class G4Step;
+class G4Track;
+class G4VProcess;
+
+// 按 (体积, 粒子, 过程) 统计步数、径迹数和 CPU 时间
+// 用于判断 production cut / kill region 该往哪里调。
+//   步: 前步点所在逻辑体积、粒子、决定步长的过程 (post-step)
+//   径迹: 起点所在逻辑体积、粒子、产生过程 ("primary" 为初级粒子)
+//   时间: 同一径迹上相邻两次 UserSteppingAction 之间的时间，计到这一步上
+//         （第一步从 PreUserTrackingAction 开始算），包含 Geant4 的输运。
+// 每个线程一份扁平表（体积/粒子/过程先映射为小整数，再用打包的键查表），
+// EndOfRunAction 时合并到按名字索引的全局表，master 写出 StepStatistics.txt。
+// 默认关闭: /CsI/stepStats/enable true
+class StepStatistics {
+public:
+  StepStatistics();
+  ~StepStatistics();
+
+  G4bool IsEnabled() const { return fEnabled; }
+
+  void BeginTrack(const G4Track *track);
+  void AddStep(const G4Step *step);
+
+  // 把本线程的表加到全局表并清空
+  void Merge();
+  // master: 写出全局表（按步数从多到少）并清空
+  static void WriteMerged(const G4String &fileName);
+
+private:
+  struct Entry {
+    G4long steps = 0;
+    G4long tracks = 0;
+    G4double seconds = 0.;
+  };
+
+  G4int VolumeID(const G4LogicalVolume *volume);
+  G4int ParticleID(const G4ParticleDefinition *particle);
+  G4int ProcessID(const G4VProcess *process);
+  Entry &Slot(G4int volumeID, G4int particleID, G4int processID);
+
+  G4GenericMessenger *fMessenger;
+  G4bool fEnabled;
+
+  std::unordered_map<const void *, G4int> fVolumeIDs;
+  std::unordered_map<const void *, G4int> fParticleIDs;
+  std::unordered_map<const void *, G4int> fProcessIDs;
+  std::vector<G4String> fVolumeNames;
+  std::vector<G4String> fParticleNames;
+  std::vector<G4String> fProcessNames;
+
+  std::unordered_map<G4long, G4int> fSlotOfKey; // packed key -> fEntries index
+  std::vector<G4long> fKeys;
+  std::vector<Entry> fEntries;
+
+  // 上一步的指针和表项，连续的步大多落在同一格
+  const void *fLastVolume;
+  const void *fLastParticle;
+  const void *fLastProcess;
+  G4int fLastSlot;
+
+  std::chrono::steady_clock::time_point fLastTime;
+};
+
+#endif
@@ -3,8 +3,13 @@
 
 #include "G4Types.hh"
 #include "G4UserSteppingAction.hh"
-#include <iostream>
-#include <map>
+#include "StepStatistics.hh"
+#include <vector>
+
+class EventWatchdog;
+class G4OpBoundaryProcess;
+class G4Track;
+
 class SteppingAction : public G4UserSteppingAction {
 public:
   SteppingAction();
@@ -12,16 +17,30 @@ public:
 
   virtual void UserSteppingAction(const G4Step *step) override;
 
-  const std::map<G4int, G4int> &GetPhotonExitCounts() const {
-    std::cout << "Accessing PhotonExitCounts with size: "
-              << fPhotonExitCounts.size() << std::endl;
+  // Photons leaving each crystal in this event, indexed by the dense crystal
+  // index; GetExitedCrystals() lists the non-zero entries in first-seen order
+  const std::vector<G4int> &GetPhotonExitCounts() const {
     return fPhotonExitCounts;
   }
+  const std::vector<G4int> &GetExitedCrystals() const {
+    return fExitedCrystals;
+  }
   void ResetCounts();
 
+  StepStatistics &GetStepStatistics() { return fStepStatistics; }
+
 private:
-  std::map<G4int, G4int> fPhotonExitCounts; // key: crystalID, value: photon
-                                            // count exiting that crystal
+  void FindBoundaryProcess(const G4Track *track);
+
+  StepStatistics fStepStatistics;
+  EventWatchdog *fWatchdog; // owned by RunAction
+  // 晶体加了表面时只统计 OpBoundary 的一种结果：absorb 模式下光子到达
+  // 晶体面即被吸收 (Absorption)，detect 模式下只计 Detection
+  G4bool fSurfaceKnown;         // false until the first optical step
+  G4int fSurfaceStatus;         // G4OpBoundaryProcessStatus, -1 = no surface
+  G4OpBoundaryProcess *fBoundary;
+  std::vector<G4int> fPhotonExitCounts;
+  std::vector<G4int> fExitedCrystals;
 };
 
-#endif
\ No newline at end of file
+#endif
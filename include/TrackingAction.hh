@@ -3,6 +3,12 @@
 #define TrackingAction_h 1
 
 #include "G4UserTrackingAction.hh"
+#include "TruthRecord.hh"
+#include "globals.hh"
+#include <vector>
+
+class MemoryMonitor;
+class StepStatistics;
 
 class TrackingAction : public G4UserTrackingAction {
 public:
@@ -10,6 +16,25 @@ public:
     virtual ~TrackingAction();
 
     virtual void PreUserTrackingAction(const G4Track* track) override;
+
+    // 径迹来自哪个初级粒子（按 PrimaryPDG 列的顺序，0 起）
+    // 每条径迹在第一步之前登记，所以本事件的 trackID 总是有效
+    G4int GetPrimaryIndex(G4int trackID) const {
+        return fPrimaryOfTrack[trackID];
+    }
+
+    TruthRecord& GetTruthRecord() { return fTruth; }
+
+private:
+    // trackID -> 初级粒子序号的平铺表，按需加倍增长。
+    // trackID 每个事件从 1 重新编号，且每条径迹在使用前都会重新登记，
+    // 所以不需要在事件之间清空
+    std::vector<G4int> fPrimaryOfTrack;
+    StepStatistics* fStepStatistics; // owned by SteppingAction
+    MemoryMonitor* fMemoryMonitor;   // owned by RunAction
+    G4int fSavedStoreTrajectory;     // -1 unless storing is switched off
+    TruthRecord fTruth;
+    G4bool fTruthEnabled;            // Truth* columns booked
 };
 
 #endif
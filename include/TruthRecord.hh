@@ -0,0 +1,53 @@
+// TruthRecord.hh
+#ifndef TRUTH_RECORD_HH
+#define TRUTH_RECORD_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+#include <unordered_map>
+#include <vector>
+
+class G4Track;
+class G4VProcess;
+
+// 超过能量阈值的次级粒子的 MC 真值（轫致辐射光子、湮灭光子、delta 电子等）
+// 比保存完整轨迹 (Trajectory) 轻得多：每个粒子只记产生点的一组值。
+// TrackingAction 在径迹开始时判断阈值并写入本线程预分配的 SoA 缓冲区，
+// EventAction 把它复制到 ntuple 的 Truth* vector 列。
+// 过程名在第一次出现时映射为 ProcessIDMap.txt 中的 ID，之后按指针查表。
+// 输出开关为 /CsI/output/truth；阈值和每个事件的上限在 /CsI/truth/ 下。
+class TruthRecord {
+public:
+  TruthRecord();
+  ~TruthRecord();
+
+  G4double GetMinEnergy() const { return fMinEnergy; }
+
+  // 新事件：清空缓冲区（保留容量）
+  void Clear();
+  // 次级粒子在产生点超过阈值时调用（调用方已检查）
+  void Add(const G4Track *track);
+
+  // SoA 列，下标为本事件记录的第几个粒子
+  std::vector<G4int> trackID;
+  std::vector<G4int> parentID;
+  std::vector<G4int> pdg;
+  std::vector<G4int> processID;
+  std::vector<G4double> energy; // kinetic energy at creation
+  std::vector<G4double> posX;
+  std::vector<G4double> posY;
+  std::vector<G4double> posZ;
+  std::vector<G4double> time;
+
+private:
+  void Reserve();
+  G4int ProcessID(const G4VProcess *process);
+
+  G4GenericMessenger *fMessenger;
+  G4double fMinEnergy;
+  G4int fMaxParticles; // per event, buffers are reserved to this size
+  G4long fDropped;     // above threshold but over fMaxParticles
+  std::unordered_map<const G4VProcess *, G4int> fProcessIDs;
+};
+
+#endif
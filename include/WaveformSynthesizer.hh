@@ -0,0 +1,62 @@
+// WaveformSynthesizer.hh
+#ifndef WAVEFORM_SYNTHESIZER_HH
+#define WAVEFORM_SYNTHESIZER_HH
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+#include <vector>
+
+class G4Material;
+
+// 闪烁脉冲波形合成
+// 把按采样周期分箱的能量沉积与 CsI 闪烁响应（上升/衰减双指数，衰减时间取自
+// 材料的 SCINTILLATIONTIMECONSTANT1）做卷积，得到固定长度的采样数组。
+//
+// Synthesize() 只对非零输入箱做 "out[k..] += a * kernel[0..]"，
+// 内层循环使用 SSE/AVX 向量指令；SynthesizeScalar() 是同一个稀疏算法
+// 不用向量指令（也不让编译器自动向量化）的版本，/CsI/waveform/benchmark
+// 比较这两者。SynthesizeReference() 是直接形式卷积，作为正确性的参考。
+class WaveformSynthesizer {
+public:
+  WaveformSynthesizer();
+  ~WaveformSynthesizer();
+
+  // 从材料表读取衰减时间并预计算响应核（参数改变后自动重新计算）
+  void Prepare();
+
+  G4int GetNSamples() const { return fNSamples; }
+  G4double GetSamplePeriod() const { return fSamplePeriod; }
+  G4double GetStartTime() const { return fStartTime; }
+
+  // 把一个能量沉积加到分箱输入上，窗口外的沉积被忽略
+  void AddDeposit(std::vector<float> &deposits, G4double time,
+                  G4double edep) const;
+
+  // deposits 和 out 都是 GetNSamples() 长度
+  void Synthesize(const float *deposits, float *out) const;
+  void SynthesizeScalar(const float *deposits, float *out) const;
+  void SynthesizeReference(const float *deposits, float *out) const;
+
+  // 用固定种子的随机输入比较向量和标量版本的速度与一致性
+  void Benchmark(G4int nCrystals);
+
+private:
+  void BuildKernel();
+
+  G4GenericMessenger *fMessenger;
+  G4int fNSamples;
+  G4double fSamplePeriod;
+  G4double fStartTime;
+  G4double fRiseTime;
+  G4double fDecayTime; // from the CsI material table when available
+  const G4Material *fCsI; // looked up once, Prepare() runs every event
+
+  // Cached configuration of the current kernel
+  G4int fKernelNSamples;
+  G4double fKernelPeriod;
+  G4double fKernelRise;
+  G4double fKernelDecay;
+  std::vector<float> fKernel; // integral of the unit-area response per sample
+};
+
+#endif
@@ -1,8 +1,10 @@
 #include "ActionInitialization.hh"
 #include "DetectorConstruction.hh"
 #include "PhysicsList.hh"
+#include "SimulationService.hh"
 
 #include <G4RunManager.hh>
+#include <G4StateManager.hh>
 #include <G4UIExecutive.hh>
 #include <G4UImanager.hh>
 #include <G4VisExecutive.hh>
@@ -17,11 +19,24 @@ int main(int argc, char **argv) {
   // Register user action initialization
   runManager->SetUserInitialization(new ActionInitialization());
 
+  auto UImanager = G4UImanager::GetUIpointer();
+
+  // 服务模式：CsI_Axion --service <spoolDir> [init.mac]
+  // 只初始化一次，之后执行 spool 目录中的请求宏（见 SimulationService.hh）
+  if (argc >= 3 && G4String(argv[1]) == "--service") {
+    if (argc >= 4)
+      UImanager->ApplyCommand(G4String("/control/execute ") + argv[3]);
+    if (G4StateManager::GetStateManager()->GetCurrentState() ==
+        G4State_PreInit)
+      UImanager->ApplyCommand("/run/initialize");
+    SimulationService(argv[2]).Run();
+    delete runManager;
+    return 0;
+  }
+
   auto visManager = new G4VisExecutive();
   visManager->Initialize();
 
-  auto UImanager = G4UImanager::GetUIpointer();
-
   G4UIExecutive *ui = nullptr;
   if (argc == 1) {
     // No macro file provided: start interactive session
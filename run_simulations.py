@@ -20,6 +20,7 @@ def parse_arguments():
     parser = argparse.ArgumentParser(description="Run Geant4 simulations in parallel.")
     parser.add_argument("output", nargs="?", default="result.root", help="Output ROOT filename (default: result.root)")
     parser.add_argument("-j", "--jobs", type=int, default=DEFAULT_CONFIG["NUM_JOBS"], help=f"Number of parallel jobs (default: {DEFAULT_CONFIG['NUM_JOBS']})")
+    parser.add_argument("--service", metavar="SPOOL_DIR", help="Submit the jobs as request macros to running 'CsI_Axion --service SPOOL_DIR' processes instead of starting one process per job")
     parser.add_argument("-n", "--events", type=int, default=DEFAULT_CONFIG["EVENTS_PER_JOB"], help=f"Events per job (default: {DEFAULT_CONFIG['EVENTS_PER_JOB']})")
 
     args = parser.parse_args()
@@ -36,6 +37,7 @@ def parse_arguments():
         events_per_job=args.events,
         output_prefix=DEFAULT_CONFIG["OUTPUT_PREFIX"],
         output_filename=output_filename,
+        service_dir=args.service,
     )
 
 
@@ -69,6 +71,53 @@ def check_environment(config):
     return True
 
 
+def job_macro(job_id, config):
+    return f"""
+/CsI/generator/mode ePairDeflected
+/CsI/random/seed {job_id} {job_id + 12345}
+/CsI/random/apply  1
+/run/beamOn {config.events_per_job}
+"""
+
+
+def run_service_jobs(config):
+    """
+    把每个作业写成请求宏放入 spool 目录，由已初始化的服务进程依次执行
+    (CsI_Axion --service SPOOL_DIR)，等待全部完成后返回成功的作业数和输出文件
+    """
+    spool = config.service_dir
+    os.makedirs(spool, exist_ok=True)
+    # 每次提交用自己的名字：不会读到以前同名请求留下的 .done/.failed/.root
+    batch = f"{time.strftime('%Y%m%d%H%M%S')}_{os.getpid()}"
+    names = [f"{config.output_prefix}{batch}_{i}" for i in range(config.num_jobs)]
+    for job_id, name in enumerate(names):
+        for suffix in (".mac.done", ".mac.failed", ".root"):
+            path = os.path.join(spool, name + suffix)
+            if os.path.exists(path):
+                os.remove(path)
+        tmp_path = os.path.join(spool, f".{name}.tmp")
+        with open(tmp_path, "w") as f:
+            f.write(job_macro(job_id, config))
+        # 改名是原子的，服务进程不会读到写了一半的宏
+        os.rename(tmp_path, os.path.join(spool, f"{name}.mac"))
+
+    pending = set(names)
+    succeeded = 0
+    while pending:
+        for name in list(pending):
+            request = os.path.join(spool, f"{name}.mac")
+            if os.path.exists(request + ".done"):
+                succeeded += 1
+            elif os.path.exists(request + ".failed"):
+                print(f"[Job {name}] FAILED!")
+            else:
+                continue
+            pending.discard(name)
+        if pending:
+            time.sleep(1)
+    return succeeded, [f"{name}.root" for name in names]
+
+
 def run_single_job(args):
     """
     Worker function.
@@ -91,13 +140,7 @@ def run_single_job(args):
         shutil.copy(exe_src, exe_dst)
 
         # Generate macro
-        mac_content = f"""
-/run/initialize
-/CsI/generator/mode ePairDeflected
-/CsI/random/seed {job_id} {job_id + 12345}
-/CsI/random/apply  1
-/run/beamOn {config.events_per_job}
-"""
+        mac_content = "\n/run/initialize" + job_macro(job_id, config)
         mac_path = os.path.join(work_dir, "run.mac")
         with open(mac_path, "w") as f:
             f.write(mac_content)
@@ -149,16 +192,17 @@ def run_single_job(args):
             shutil.rmtree(work_dir)
 
 
-def merge_results(config):
+def merge_results(config, source_dir=None, output_files=None):
     print("Merging files...")
+    source_dir = source_dir or config.build_dir
     target_file_path = os.path.join(config.data_dir, config.output_filename)
     abs_target_path = os.path.abspath(target_file_path)
 
-    output_files = [f"{config.output_prefix}{i}.root" for i in range(config.num_jobs)]
+    output_files = output_files or [f"{config.output_prefix}{i}.root" for i in range(config.num_jobs)]
     merge_cmd = ["hadd", "-f", abs_target_path] + output_files
 
     try:
-        subprocess.run(merge_cmd, cwd=config.build_dir, check=True)
+        subprocess.run(merge_cmd, cwd=source_dir, check=True)
         print(f"Successfully merged {len(output_files)} files into '{target_file_path}'")
 
         # Cleanup individual files
@@ -183,18 +227,23 @@ def main():
     print(f"  Events/Job:  {config.events_per_job}")
     print(f"  Total Events: {config.num_jobs * config.events_per_job}")
 
-    # Prepare arguments for workers
-    worker_args = [(i, config) for i in range(config.num_jobs)]
+    if config.service_dir:
+        print(f"Submitting {config.num_jobs} requests to {config.service_dir}...")
+        success_count, output_files = run_service_jobs(config)
+    else:
+        output_files = None
+        # Prepare arguments for workers
+        worker_args = [(i, config) for i in range(config.num_jobs)]
 
-    print(f"Starting {config.num_jobs} jobs...")
-    with multiprocessing.Pool(processes=config.num_jobs) as pool:
-        results = pool.map(run_single_job, worker_args)
+        print(f"Starting {config.num_jobs} jobs...")
+        with multiprocessing.Pool(processes=config.num_jobs) as pool:
+            results = pool.map(run_single_job, worker_args)
+        success_count = sum(results)
 
-    success_count = sum(results)
     print(f"\nSummary: {success_count}/{config.num_jobs} jobs succeeded.")
 
     if success_count == config.num_jobs:
-        merge_results(config)
+        merge_results(config, config.service_dir, output_files)
     else:
         print(f"Some jobs failed. Skipping merge.")
 
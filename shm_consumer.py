@@ -0,0 +1,126 @@
+import argparse
+import mmap
+import os
+import struct
+import time
+
+import numpy as np
+
+# 共享内存事件流的读取端，布局见 SHM_STREAM_README.md 和 ShmEventSink.hh
+MAGIC = b"CSISHM01"
+HEADER = struct.Struct("<8sIIQQQIi")  # magic version nSlots slotBytes dataOffset writeIndex stopRequested runID
+SLOT_HEADER = struct.Struct("<QQiIddII5I")  # seq index eventID nHits totalEdep eventWeight nPhotonExit flags offsets[5]
+WRITE_INDEX_OFFSET = 32
+STOP_REQUESTED_OFFSET = 40
+TRUNCATED = 1
+
+
+class ShmEventStream:
+    """
+    映射 /dev/shm/<name>，按顺序读取新发布的事件
+    共享内存本身是零拷贝映射；每个事件的数组复制一次，
+    以便用 seqlock 确认读取期间该槽没有被覆盖。
+    """
+
+    def __init__(self, name):
+        path = os.path.join("/dev/shm", name.lstrip("/"))
+        with open(path, "r+b") as f:
+            self.buffer = mmap.mmap(f.fileno(), 0)
+        magic, version, self.n_slots, self.slot_bytes, self.data_offset, _, _, _ = HEADER.unpack_from(self.buffer, 0)
+        if magic != MAGIC:
+            raise ValueError(f"'{path}' is not a CsI event stream")
+        self.next_index = 0
+        self.lost = 0
+
+    def write_index(self):
+        return struct.unpack_from("<Q", self.buffer, WRITE_INDEX_OFFSET)[0]
+
+    def run_id(self):
+        return HEADER.unpack_from(self.buffer, 0)[7]
+
+    def request_stop(self):
+        """让模拟在下一个事件结束时中止 run"""
+        struct.pack_into("<I", self.buffer, STOP_REQUESTED_OFFSET, 1)
+
+    def _read_slot(self, index):
+        base = self.data_offset + (index % self.n_slots) * self.slot_bytes
+        seq = struct.unpack_from("<Q", self.buffer, base)[0]
+        if seq & 1:
+            return None, True  # 正在写，稍后再读
+        _, slot_index, event_id, n_hits, total_edep, weight, n_exit, flags, *offsets = SLOT_HEADER.unpack_from(self.buffer, base)
+        if slot_index != index:
+            return None, False  # 已被覆盖（或尚未写入）
+
+        def column(k, dtype, n):
+            return np.frombuffer(self.buffer, dtype=dtype, count=n, offset=base + offsets[k]).copy()
+
+        event = {
+            "EventID": event_id,
+            "TotalEdep": total_edep,
+            "EventWeight": weight,
+            "Truncated": bool(flags & TRUNCATED),
+            "CrystalEdep": column(0, "<f8", n_hits),
+            "CrystalTime": column(1, "<f8", n_hits),
+            "CrystalID": column(2, "<i4", n_hits),
+            "PhotonExitCrystalID": column(3, "<i4", n_exit),
+            "PhotonExitCount": column(4, "<i4", n_exit),
+        }
+        if struct.unpack_from("<Q", self.buffer, base)[0] != seq:
+            return None, False  # 读取期间被覆盖
+        return event, False
+
+    def poll(self):
+        """返回上次调用以来发布的事件；被覆盖的事件计入 self.lost"""
+        events = []
+        end = self.write_index()
+        if end - self.next_index > self.n_slots:
+            self.lost += end - self.n_slots - self.next_index
+            self.next_index = end - self.n_slots
+        while self.next_index < end:
+            event, busy = self._read_slot(self.next_index)
+            if busy:
+                break
+            if event is None:
+                self.lost += 1
+            else:
+                events.append(event)
+            self.next_index += 1
+        return events
+
+
+def monitor(name, target_precision, min_events, interval):
+    """
+    在线监视 TotalEdep 的加权平均；相对统计误差低于 target_precision 时
+    请求模拟提前结束
+    """
+    stream = ShmEventStream(name)
+    sum_w = sum_wx = sum_wxx = 0.0
+    n = 0
+    while True:
+        for event in stream.poll():
+            w, x = event["EventWeight"], event["TotalEdep"]
+            sum_w += w
+            sum_wx += w * x
+            sum_wxx += w * x * x
+            n += 1
+        if n > 1 and sum_w > 0:
+            mean = sum_wx / sum_w
+            rms = max(sum_wxx / sum_w - mean * mean, 0.0) ** 0.5
+            error = rms / n**0.5
+            precision = error / abs(mean) if mean != 0 else float("inf")
+            print(f"[Info] run {stream.run_id()}: {n} events, mean TotalEdep = {mean:.4f} +- {error:.4f} MeV (lost {stream.lost})")
+            if target_precision > 0 and n >= min_events and precision < target_precision:
+                print(f"[Info] Relative precision {precision:.2e} reached, requesting stop")
+                stream.request_stop()
+                return
+        time.sleep(interval)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Live monitor for the shared-memory event stream (/CsI/output/shmName).")
+    parser.add_argument("name", nargs="?", default="/csi_events", help="Shared-memory name (default: /csi_events)")
+    parser.add_argument("--precision", type=float, default=0.0, help="Stop the run once the relative error of the mean TotalEdep is below this (0: never)")
+    parser.add_argument("--min-events", type=int, default=1000, help="Minimum events before stopping")
+    parser.add_argument("--interval", type=float, default=1.0, help="Polling interval in seconds")
+    args = parser.parse_args()
+    monitor(args.name, args.precision, args.min_events, args.interval)
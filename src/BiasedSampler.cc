@@ -0,0 +1,169 @@
+// BiasedSampler.cc
+#include "BiasedSampler.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+G4int PiecewisePDF::Load(const G4String &fileName, G4double unit,
+                         G4double xmax) {
+  std::ifstream in(fileName);
+  if (!in) {
+    G4cerr << "[BiasedSampler] Cannot open PDF file: " << fileName << G4endl;
+    return 0;
+  }
+
+  std::vector<G4double> low, high, density;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream iss(line);
+    G4double a, b, f;
+    if (!(iss >> a >> b >> f))
+      continue;
+    a = std::max(a * unit, 0.);
+    b = std::min(b * unit, xmax);
+    if (b <= a || f <= 0.)
+      continue;
+    low.push_back(a);
+    high.push_back(b);
+    density.push_back(f);
+  }
+
+  G4double total = 0.;
+  for (size_t i = 0; i < low.size(); i++)
+    total += density[i] * (high[i] - low[i]);
+  if (total <= 0.) {
+    G4cerr << "[BiasedSampler] No usable bins in " << fileName << G4endl;
+    return 0;
+  }
+
+  fLow = low;
+  fHigh = high;
+  fDensity.clear();
+  fCumulative.clear();
+  G4double sum = 0.;
+  for (size_t i = 0; i < fLow.size(); i++) {
+    fDensity.push_back(density[i] / total);
+    sum += fDensity.back() * (fHigh[i] - fLow[i]);
+    fCumulative.push_back(sum);
+  }
+  fCumulative.back() = 1.;
+  return fLow.size();
+}
+
+G4bool PiecewisePDF::Covers(G4double xmax) const {
+  std::vector<size_t> order(fLow.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [this](size_t a, size_t b) { return fLow[a] < fLow[b]; });
+  G4double tolerance = 1e-9 * xmax;
+  G4double reach = 0.;
+  for (size_t i : order) {
+    if (fLow[i] > reach + tolerance)
+      return false;
+    reach = std::max(reach, fHigh[i]);
+  }
+  return reach >= xmax - tolerance;
+}
+
+void PiecewisePDF::Clear() {
+  fLow.clear();
+  fHigh.clear();
+  fDensity.clear();
+  fCumulative.clear();
+}
+
+G4double PiecewisePDF::Sample(G4double &density) const {
+  G4double r = G4UniformRand();
+  size_t bin = std::upper_bound(fCumulative.begin(), fCumulative.end(), r) -
+               fCumulative.begin();
+  bin = std::min(bin, fLow.size() - 1);
+  density = fDensity[bin];
+  return fLow[bin] + G4UniformRand() * (fHigh[bin] - fLow[bin]);
+}
+
+// ---------------------------------------------------------------------------
+
+G4int BiasedSampler::LoadEnergyPDF(const G4String &fileName,
+                                   G4double maxEnergy) {
+  PiecewisePDF pdf;
+  G4int nBins = pdf.Load(fileName, MeV, maxEnergy);
+  if (nBins == 0)
+    return 0;
+  if (!pdf.Covers(maxEnergy)) {
+    G4cerr << "[BiasedSampler] Energy PDF " << fileName
+           << " does not cover [0, " << maxEnergy / MeV
+           << "] MeV, not loaded" << G4endl;
+    return 0;
+  }
+  fEnergyPDF = pdf;
+  G4cout << "[BiasedSampler] Energy PDF: " << nBins << " bins from "
+         << fileName << G4endl;
+  return nBins;
+}
+
+G4int BiasedSampler::LoadBoundaryPDF(const G4String &fileName,
+                                     G4double crystalSize) {
+  PiecewisePDF pdf;
+  G4int nBins = pdf.Load(fileName, mm, 0.5 * crystalSize);
+  if (nBins == 0)
+    return 0;
+  if (!pdf.Covers(0.5 * crystalSize)) {
+    G4cerr << "[BiasedSampler] Boundary-distance PDF " << fileName
+           << " does not cover [0, " << 0.5 * crystalSize / mm
+           << "] mm, not loaded" << G4endl;
+    return 0;
+  }
+  fBoundaryPDF = pdf;
+  G4cout << "[BiasedSampler] Boundary-distance PDF: " << nBins
+         << " bins from " << fileName << G4endl;
+  return nBins;
+}
+
+G4double BiasedSampler::SampleEnergy(G4double maxEnergy,
+                                     G4double &weight) const {
+  if (fEnergyPDF.IsEmpty())
+    return G4UniformRand() * maxEnergy;
+
+  G4double q;
+  G4double energy = fEnergyPDF.Sample(q);
+  weight *= (1. / maxEnergy) / q;
+  return energy;
+}
+
+G4ThreeVector BiasedSampler::SampleLocalPosition(G4double crystalSize,
+                                                 G4double &weight) const {
+  if (fBoundaryPDF.IsEmpty()) {
+    // 晶体内均匀撒点，坐标偏移[-crystalSize/2, crystalSize/2]
+    G4double localX = (G4UniformRand() - 0.5) * crystalSize;
+    G4double localY = (G4UniformRand() - 0.5) * crystalSize;
+    G4double localZ = (G4UniformRand() - 0.5) * crystalSize;
+    return G4ThreeVector(localX, localY, localZ);
+  }
+
+  G4double q;
+  G4double d = fBoundaryPDF.Sample(q);
+  G4double h = 0.5 * crystalSize - d;
+  G4double p = 24. * h * h / (crystalSize * crystalSize * crystalSize);
+  weight *= p / q;
+
+  // 边长 2h 的立方体表面上均匀取点：六个面面积相同
+  G4int face = std::min(static_cast<G4int>(G4UniformRand() * 6), 5);
+  G4double u = (2. * G4UniformRand() - 1.) * h;
+  G4double v = (2. * G4UniformRand() - 1.) * h;
+  G4double w = (face % 2 == 0) ? h : -h;
+  switch (face / 2) {
+  case 0:
+    return G4ThreeVector(w, u, v);
+  case 1:
+    return G4ThreeVector(u, w, v);
+  default:
+    return G4ThreeVector(u, v, w);
+  }
+}
@@ -0,0 +1,187 @@
+// Checkpoint.cc
+#include "Checkpoint.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "G4ios.hh"
+#include "Randomize.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+Checkpoint::Checkpoint(const G4String &outputName)
+    : fMessenger(nullptr), fOutputName(outputName), fEveryEvents(0),
+      fInterval(0.), fExitAfter(0), fSaves(0), fResumePending(false),
+      fActive(false), fEventOffset(0), fEventsTotal(0), fPart(0),
+      fLastSaved(0) {
+  fMessenger = new G4GenericMessenger(this, "/CsI/checkpoint/",
+                                      "Checkpoint and resume long runs");
+  fMessenger->DeclareProperty("everyEvents", fEveryEvents,
+                              "Write a checkpoint every N events (0 = off)");
+  fMessenger->DeclarePropertyWithUnit(
+      "interval", "s", fInterval,
+      "Write a checkpoint when this much wall time has passed (0 = off)");
+  fMessenger->DeclareProperty(
+      "exitAfter", fExitAfter,
+      "Testing: end the process right after the Nth checkpoint, as if the "
+      "job had been killed (0 = off)");
+  fMessenger->DeclareMethod(
+      "resume", &Checkpoint::Resume,
+      "Continue the interrupted run of /CsI/output/fileName from its last "
+      "checkpoint (instead of /run/beamOn)");
+}
+
+Checkpoint::~Checkpoint() { delete fMessenger; }
+
+G4String Checkpoint::PartFileName() const {
+  return fOutputName + "_part" + std::to_string(fPart);
+}
+
+G4bool Checkpoint::ReadState(State &state) const {
+  std::ifstream in(StateFileName());
+  if (!in)
+    return false;
+  state = State();
+  G4String key;
+  while (in >> key) {
+    if (key == "eventsDone") {
+      in >> state.eventsDone;
+    } else if (key == "eventsTotal") {
+      in >> state.eventsTotal;
+    } else if (key == "part") {
+      in >> state.part;
+    } else if (key == "process") {
+      int id;
+      G4String name;
+      in >> id >> name;
+      state.processMap[name] = id;
+    } else {
+      std::getline(in, key); // 注释或未知字段
+    }
+  }
+  return state.eventsTotal > 0;
+}
+
+void Checkpoint::Resume() {
+  State state;
+  if (!ReadState(state)) {
+    G4cerr << "[Checkpoint] No checkpoint found in " << StateFileName()
+           << G4endl;
+    return;
+  }
+  if (state.eventsDone >= state.eventsTotal) {
+    G4cout << "[Checkpoint] " << StateFileName() << ": all "
+           << state.eventsTotal << " events already done" << G4endl;
+    return;
+  }
+  G4cout << "[Checkpoint] Resuming " << fOutputName << " at event "
+         << state.eventsDone << " of " << state.eventsTotal << " (part "
+         << state.part << ")" << G4endl;
+  fResumeState = state;
+  fResumePending = true;
+  G4RunManager::GetRunManager()->BeamOn(state.eventsTotal - state.eventsDone);
+  fResumePending = false;
+}
+
+void Checkpoint::BeginRun(G4int nEvents,
+                          std::map<G4String, int> &processMap) {
+  fActive = fResumePending || fEveryEvents > 0 || fInterval > 0.;
+  if (fActive && G4Threading::IsMultithreadedApplication()) {
+    G4cerr << "[Checkpoint] Checkpoints need the sequential run manager, "
+              "disabled"
+           << G4endl;
+    fActive = false;
+  }
+  if (!fActive)
+    return;
+
+  if (fResumePending) {
+    // 续跑：随机数引擎回到检查点时的状态，ProcessID 与已写出的 part 一致
+    CLHEP::HepRandom::restoreEngineStatus(EngineFileName().c_str());
+    processMap = fResumeState.processMap;
+    fEventOffset = fResumeState.eventsDone;
+    fEventsTotal = fResumeState.eventsTotal;
+    fPart = fResumeState.part;
+  } else {
+    fEventOffset = 0;
+    fEventsTotal = nEvents;
+    fPart = 0;
+  }
+  fLastSaved = fEventOffset;
+  fLastSaveTime = std::chrono::steady_clock::now();
+}
+
+G4bool Checkpoint::IsDue(G4int eventsDone) const {
+  // 最后一个事件之后由 EndOfRunAction 正常收尾
+  if (!fActive || eventsDone >= fEventsTotal)
+    return false;
+  if (fEveryEvents > 0 && eventsDone - fLastSaved >= fEveryEvents)
+    return true;
+  if (fInterval > 0.) {
+    G4double elapsed = std::chrono::duration<G4double>(
+                           std::chrono::steady_clock::now() - fLastSaveTime)
+                           .count() *
+                       s;
+    return elapsed >= fInterval;
+  }
+  return false;
+}
+
+void Checkpoint::Save(G4int eventsDone,
+                      const std::map<G4String, int> &processMap) {
+  fPart++;
+
+  // 先写临时文件再改名：中断在任何时刻，留下的都是完整的上一个检查点
+  G4String engineTmp = EngineFileName() + ".tmp";
+  CLHEP::HepRandom::saveEngineStatus(engineTmp.c_str());
+  rename(engineTmp.c_str(), EngineFileName().c_str());
+
+  G4String stateTmp = StateFileName() + ".tmp";
+  {
+    std::ofstream out(stateTmp);
+    out << "# " << fOutputName << " checkpoint\n"
+        << "eventsDone " << eventsDone << "\n"
+        << "eventsTotal " << fEventsTotal << "\n"
+        << "part " << fPart << "\n";
+    for (const auto &pair : processMap)
+      out << "process " << pair.second << " " << pair.first << "\n";
+  }
+  rename(stateTmp.c_str(), StateFileName().c_str());
+
+  fLastSaved = eventsDone;
+  fLastSaveTime = std::chrono::steady_clock::now();
+  G4cout << "[Checkpoint] " << eventsDone << "/" << fEventsTotal
+         << " events saved, continuing in " << PartFileName() << ".root"
+         << G4endl;
+
+  if (fExitAfter > 0 && ++fSaves >= fExitAfter) {
+    G4cout << "[Checkpoint] exitAfter " << fExitAfter << ": exiting" << G4endl;
+    std::_Exit(EXIT_FAILURE);
+  }
+}
+
+void Checkpoint::EndRun() {
+  if (!fActive)
+    return;
+  fActive = false;
+
+  // part 按顺序合并：ntuple 的行顺序与不分段的 run 相同，直方图相加
+  std::ostringstream parts;
+  for (G4int i = 0; i <= fPart; i++)
+    parts << " '" << fOutputName << "_part" << i << ".root'";
+  G4String command =
+      "hadd -f '" + fOutputName + ".root'" + parts.str() + " > /dev/null";
+  if (std::system(command.c_str()) != 0) {
+    G4cerr << "[Checkpoint] hadd failed, parts kept; merge them with:\n  "
+           << command << G4endl;
+    return;
+  }
+  for (G4int i = 0; i <= fPart; i++)
+    std::remove((fOutputName + "_part" + std::to_string(i) + ".root").c_str());
+  std::remove(StateFileName().c_str());
+  std::remove(EngineFileName().c_str());
+  G4cout << "[Checkpoint] " << fPart + 1 << " parts merged into "
+         << fOutputName << ".root" << G4endl;
+}
@@ -0,0 +1,150 @@
+// CrystalClusterer.cc
+
+#include "CrystalClusterer.hh"
+#include "CrystalArray.hh"
+#include "DetectorConstruction.hh"
+#include "G4RunManager.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+constexpr G4int kMaxNeighbours = 26;
+}
+
+CrystalClusterer::CrystalClusterer()
+    : fMessenger(nullptr), fConnectivity(26), fCrystalThreshold(0.),
+      fSeedThreshold(0.), fTableConnectivity(0),
+      fEdep(CrystalArray::kNCrystals, 0.),
+      fTime(CrystalArray::kNCrystals, 0.),
+      fLabel(CrystalArray::kNCrystals, -1) {
+  fMessenger = new G4GenericMessenger(this, "/CsI/cluster/",
+                                      "Crystal clustering control");
+  fMessenger
+      ->DeclareProperty("connectivity", fConnectivity,
+                        "Neighbour definition: 6 (faces), 18 (+edges) or "
+                        "26 (+corners)")
+      .SetCandidates("6 18 26");
+  fMessenger->DeclarePropertyWithUnit(
+      "crystalThreshold", "MeV", fCrystalThreshold,
+      "Crystals below this deposit are not clustered");
+  fMessenger->DeclarePropertyWithUnit(
+      "seedThreshold", "MeV", fSeedThreshold,
+      "Minimum deposit of the most energetic crystal of a cluster");
+
+  fFired.reserve(CrystalArray::kNCrystals);
+  fQueue.reserve(CrystalArray::kNCrystals);
+}
+
+CrystalClusterer::~CrystalClusterer() { delete fMessenger; }
+
+void CrystalClusterer::BuildNeighbourTable() {
+  using namespace CrystalArray;
+  fNeighbours.assign(static_cast<size_t>(kNCrystals) * kMaxNeighbours, -1);
+  fNNeighbours.assign(kNCrystals, 0);
+
+  for (G4int i = 0; i < kNCrystals; i++) {
+    G4int ix = IndexX(i), iy = IndexY(i), iz = IndexZ(i);
+    for (G4int dx = -1; dx <= 1; dx++) {
+      for (G4int dy = -1; dy <= 1; dy++) {
+        for (G4int dz = -1; dz <= 1; dz++) {
+          // 偏移分量非零的个数: 1 共面, 2 共棱, 3 共顶点
+          G4int order = std::abs(dx) + std::abs(dy) + std::abs(dz);
+          if (order == 0 || (fConnectivity == 6 && order > 1) ||
+              (fConnectivity == 18 && order > 2))
+            continue;
+          G4int jx = ix + dx, jy = iy + dy, jz = iz + dz;
+          if (jx < 0 || jx >= kNx || jy < 0 || jy >= kNy || jz < 0 ||
+              jz >= kNz)
+            continue;
+          fNeighbours[i * kMaxNeighbours + fNNeighbours[i]++] =
+              EncodeIndex(jx, jy, jz);
+        }
+      }
+    }
+  }
+  fTableConnectivity = fConnectivity;
+}
+
+void CrystalClusterer::Prepare() {
+  if (fTableConnectivity != fConnectivity)
+    BuildNeighbourTable();
+
+  // 晶体中心取自 DetectorConstruction 放置时记录的位置表
+  if (fCentre.empty()) {
+    auto detector = static_cast<const DetectorConstruction *>(
+        G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+    if (detector)
+      fCentre = detector->GetCrystalCentres();
+    fCentre.resize(CrystalArray::kNCrystals);
+  }
+}
+
+void CrystalClusterer::AddDeposit(G4int index, G4double edep,
+                                  G4double time) {
+  if (index < 0 || index >= CrystalArray::kNCrystals || edep <= 0.)
+    return;
+  if (fEdep[index] == 0.) {
+    fFired.push_back(index);
+    fTime[index] = time;
+  } else {
+    fTime[index] = std::min(fTime[index], time);
+  }
+  fEdep[index] += edep;
+}
+
+void CrystalClusterer::Reconstruct() {
+  fClusters.clear();
+
+  // 能量从高到低：每个连通块第一个被访问的晶体就是其中能量最大的
+  std::sort(fFired.begin(), fFired.end(),
+            [this](G4int a, G4int b) { return fEdep[a] > fEdep[b]; });
+
+  for (G4int seed : fFired) {
+    if (fLabel[seed] >= 0 || fEdep[seed] < fCrystalThreshold)
+      continue;
+
+    G4int label = fClusters.size();
+    CsICluster cluster;
+    cluster.energy = 0.;
+    cluster.centroid = G4ThreeVector();
+    cluster.time = fTime[seed];
+    cluster.size = 0;
+    cluster.seedCopyNo = CrystalArray::IndexToCopyNo(seed);
+
+    fQueue.clear();
+    fQueue.push_back(seed);
+    fLabel[seed] = label;
+    for (size_t head = 0; head < fQueue.size(); head++) {
+      G4int i = fQueue[head];
+      cluster.energy += fEdep[i];
+      cluster.centroid += fEdep[i] * fCentre[i];
+      cluster.time = std::min(cluster.time, fTime[i]);
+      cluster.size++;
+
+      const G4int *neighbours = &fNeighbours[i * kMaxNeighbours];
+      for (G4int k = 0; k < fNNeighbours[i]; k++) {
+        G4int j = neighbours[k];
+        if (fLabel[j] >= 0 || fEdep[j] <= 0. || fEdep[j] < fCrystalThreshold)
+          continue;
+        fLabel[j] = label;
+        fQueue.push_back(j);
+      }
+    }
+
+    if (fEdep[seed] < fSeedThreshold) {
+      // 保留标记以免其成员再作为种子，但不输出
+      continue;
+    }
+    cluster.centroid /= cluster.energy;
+    fClusters.push_back(cluster);
+  }
+
+  // 只清除本事件用到的晶体
+  for (G4int i : fFired) {
+    fEdep[i] = 0.;
+    fLabel[i] = -1;
+  }
+  fFired.clear();
+}
@@ -0,0 +1,164 @@
+// CsIDigitizer.cc
+
+#include "CsIDigitizer.hh"
+#include "CrystalArray.hh"
+#include "DetectorSD.hh"
+#include "G4DigiManager.hh"
+#include "G4Poisson.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+G4ThreadLocal G4Allocator<CsIDigi> *CsIDigiAllocator = 0;
+
+CsIDigi::CsIDigi() : G4VDigi(), fCrystalID(-1), fADC(0), fTDC(-1) {}
+CsIDigi::~CsIDigi() {}
+
+void CsIDigi::Print() {
+  G4cout << "  Digi crystal " << fCrystalID << " ADC=" << fADC
+         << " TDC=" << fTDC << G4endl;
+}
+
+CsIDigitizer::CsIDigitizer(const G4String &name)
+    : G4VDigitizerModule(name), fMessenger(nullptr), fHCID(-1),
+      fLightYield(CrystalArray::kNCrystals, 54000. / MeV),
+      fQE(CrystalArray::kNCrystals, 0.2),
+      fNoise(CrystalArray::kNCrystals, 2.0),
+      fThreshold(CrystalArray::kNCrystals, 10.0),
+      fGain(CrystalArray::kNCrystals, 0.01), fAdcMax(16383),
+      fTimeResolution(1. * ns), fTdcLSB(0.5 * ns),
+      fEdep(CrystalArray::kNCrystals, 0.),
+      fTime(CrystalArray::kNCrystals, 0.),
+      fNoiseSample(CrystalArray::kNCrystals, 0.) {
+  collectionName.push_back("CsIDigiCollection");
+
+  fMessenger =
+      new G4GenericMessenger(this, "/CsI/digi/", "Digitization control");
+  fMessenger->DeclareMethod("lightYield", &CsIDigitizer::SetLightYield,
+                            "Scintillation yield (photons/MeV), all crystals");
+  fMessenger->DeclareMethod("quantumEfficiency",
+                            &CsIDigitizer::SetQuantumEfficiency,
+                            "Photodetector quantum efficiency, all crystals");
+  fMessenger->DeclareMethod("noise", &CsIDigitizer::SetNoise,
+                            "Electronic noise sigma (ADC), all crystals");
+  fMessenger->DeclareMethod("threshold", &CsIDigitizer::SetThreshold,
+                            "Zero-suppression threshold (ADC), all crystals");
+  fMessenger->DeclareMethod("gain", &CsIDigitizer::SetGain,
+                            "ADC counts per photoelectron, all crystals");
+  fMessenger->DeclareMethod("calibFile", &CsIDigitizer::LoadCalibration,
+                            "Load per-crystal calibration from a text file");
+  fMessenger->DeclareProperty("adcMax", fAdcMax, "ADC saturation value");
+  fMessenger->DeclarePropertyWithUnit("timeResolution", "ns", fTimeResolution,
+                                      "Gaussian time resolution");
+  fMessenger->DeclarePropertyWithUnit("tdcLSB", "ns", fTdcLSB,
+                                      "TDC least significant bit");
+}
+
+CsIDigitizer::~CsIDigitizer() { delete fMessenger; }
+
+void CsIDigitizer::SetLightYield(G4double perMeV) {
+  std::fill(fLightYield.begin(), fLightYield.end(), perMeV / MeV);
+}
+void CsIDigitizer::SetQuantumEfficiency(G4double qe) {
+  std::fill(fQE.begin(), fQE.end(), qe);
+}
+void CsIDigitizer::SetNoise(G4double adc) {
+  std::fill(fNoise.begin(), fNoise.end(), adc);
+}
+void CsIDigitizer::SetThreshold(G4double adc) {
+  std::fill(fThreshold.begin(), fThreshold.end(), adc);
+}
+void CsIDigitizer::SetGain(G4double adcPerPE) {
+  std::fill(fGain.begin(), fGain.end(), adcPerPE);
+}
+
+void CsIDigitizer::LoadCalibration(const G4String &fileName) {
+  std::ifstream in(fileName);
+  if (!in) {
+    G4cerr << "[CsIDigitizer] Cannot open calibration file: " << fileName
+           << G4endl;
+    return;
+  }
+
+  G4int nLoaded = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream iss(line);
+    G4int copyNo;
+    G4double ly, qe, noise, threshold, gain;
+    if (!(iss >> copyNo >> ly >> qe >> noise >> threshold >> gain))
+      continue;
+    if (!CrystalArray::IsValidCopyNo(copyNo)) {
+      G4cerr << "[CsIDigitizer] " << fileName << ": crystal " << copyNo
+             << " outside the " << CrystalArray::kNx << "x"
+             << CrystalArray::kNy << "x" << CrystalArray::kNz
+             << " array, line skipped" << G4endl;
+      continue;
+    }
+    G4int index = CrystalArray::CopyNoToIndex(copyNo);
+    fLightYield[index] = ly / MeV;
+    fQE[index] = qe;
+    fNoise[index] = noise;
+    fThreshold[index] = threshold;
+    fGain[index] = gain;
+    nLoaded++;
+  }
+  G4cout << "[CsIDigitizer] Loaded calibration for " << nLoaded
+         << " crystals from " << fileName << G4endl;
+}
+
+void CsIDigitizer::Digitize() {
+  auto digiManager = G4DigiManager::GetDMpointer();
+  if (fHCID < 0)
+    fHCID = digiManager->GetHitsCollectionID("CsIHitsCollection");
+
+  auto digitsCollection =
+      new CsIDigitsCollection(moduleName, collectionName[0]);
+
+  // 把 hit 散射到按晶体索引的扁平数组
+  std::fill(fEdep.begin(), fEdep.end(), 0.);
+  auto hitsCollection = static_cast<const CsIHitsCollection *>(
+      digiManager->GetHitsCollection(fHCID));
+  if (hitsCollection) {
+    G4int nHits = hitsCollection->entries();
+    for (G4int i = 0; i < nHits; i++) {
+      auto hit = (*hitsCollection)[i];
+      G4int index = hit->GetChamberNb();
+      fEdep[index] += hit->GetEdep();
+      fTime[index] = hit->GetTime();
+    }
+  }
+
+  // 一次生成全部晶体的噪声
+  G4RandGauss::shootArray(CrystalArray::kNCrystals, fNoiseSample.data(), 0.,
+                          1.);
+
+  for (G4int i = 0; i < CrystalArray::kNCrystals; i++) {
+    G4double amplitude = fNoiseSample[i] * fNoise[i];
+    G4bool fired = fEdep[i] > 0.;
+    if (fired) {
+      G4double meanPE = fEdep[i] * fLightYield[i] * fQE[i];
+      amplitude += G4Poisson(meanPE) * fGain[i];
+    }
+    if (amplitude < fThreshold[i])
+      continue;
+
+    auto digi = new CsIDigi();
+    digi->SetCrystalID(CrystalArray::IndexToCopyNo(i));
+    digi->SetADC(std::min<G4int>(std::lround(amplitude), fAdcMax));
+    if (fired) {
+      G4double t = fTime[i] + G4RandGauss::shoot(0., fTimeResolution);
+      digi->SetTDC(std::max<G4int>(0, std::lround(t / fTdcLSB)));
+    }
+    digitsCollection->insert(digi);
+  }
+
+  StoreDigiCollection(digitsCollection);
+}
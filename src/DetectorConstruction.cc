@@ -1,34 +1,180 @@
 #include "DetectorConstruction.hh"
 
+#include "CrystalArray.hh"
 #include "DetectorSD.hh"
 #include "G4LogicalSkinSurface.hh"
 #include "G4OpticalSurface.hh"
+#include "G4Electron.hh"
+#include "G4GeometryManager.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4Positron.hh"
+#include "G4RunManager.hh"
 #include "G4SDManager.hh"
+#include "G4SolidStore.hh"
+#include "GFlashHitMaker.hh"
+#include "GFlashHomoShowerParameterisation.hh"
+#include "GFlashParticleBounds.hh"
+#include "GFlashShowerModel.hh"
+#include "PhysicsList.hh"
 #include <G4Box.hh>
 #include <G4LogicalVolume.hh>
 #include <G4NistManager.hh>
 #include <G4PVPlacement.hh>
 #include <G4SystemOfUnits.hh>
 #include <G4VisAttributes.hh> // 可视化属性
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace {
+// 读取 "wavelength(nm) value" 两列的数据文件（# 开头为注释），
+// 转换为按光子能量升序的表；value 乘以 unit
+G4bool LoadSpectrum(const G4String &fileName, G4double unit,
+                    std::vector<G4double> &energy,
+                    std::vector<G4double> &value) {
+  std::ifstream in(fileName);
+  if (!in)
+    return false;
+  std::vector<std::pair<G4double, G4double>> table;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream iss(line);
+    G4double wavelength, v;
+    if (iss >> wavelength >> v && wavelength > 0.)
+      table.emplace_back(h_Planck * c_light / (wavelength * nm), v * unit);
+  }
+  if (table.size() < 2)
+    return false;
+  std::sort(table.begin(), table.end());
+  energy.clear();
+  value.clear();
+  for (const auto &entry : table) {
+    energy.push_back(entry.first);
+    value.push_back(entry.second);
+  }
+  return true;
+}
+
+// 从数据文件读取属性；文件不可用时退回到 [2, 4] eV 的常数
+void AddSpectrum(G4MaterialPropertiesTable *mpt, const char *key,
+                 const G4String &fileName, G4double unit,
+                 G4double fallback) {
+  std::vector<G4double> energy, value;
+  if (!LoadSpectrum(fileName, unit, energy, value)) {
+    G4cerr << "[DetectorConstruction] Cannot read " << fileName
+           << ", using constant " << key << G4endl;
+    energy = {2.0 * eV, 4.0 * eV};
+    value = {fallback, fallback};
+  }
+  mpt->AddProperty(key, energy.data(), value.data(), energy.size());
+}
 
-DetectorConstruction::DetectorConstruction() : fGapMaterial("Air") {
+// 快速模拟模型是线程局部的，每个 worker 在 ConstructSDandField 中创建
+G4ThreadLocal GFlashShowerModel *fastShowerModel = nullptr;
+G4ThreadLocal GFlashHomoShowerParameterisation *showerParameterisation =
+    nullptr;
+G4ThreadLocal GFlashParticleBounds *showerParticleBounds = nullptr;
+G4ThreadLocal GFlashHitMaker *showerHitMaker = nullptr;
+} // namespace
+
+DetectorConstruction::DetectorConstruction()
+    : fGapMaterial("Air"), fOpticalDataDir("."), fSurfaceMode("none"),
+      fSurfaceEfficiency(1.), fFastShowerMinEnergy(100. * MeV),
+      fArrayRegion(nullptr), fGapLV(nullptr), fTimeBinCount(0),
+      fTimeBinWidth(10. * ns), fTimeBinStart(0.), fAir(nullptr),
+      fOpticalGrease(nullptr), fCsI(nullptr), fMptAir(nullptr),
+      fMptGrease(nullptr), fMptCsI(nullptr) {
   fMessenger = new G4GenericMessenger(this, "/CsI/detector/",
                                       "Detector construction control");
   fMessenger->DeclareProperty(
       "gapMaterial", fGapMaterial,
       "Material for gaps between crystals: Air or OpticalGrease");
+  fMessenger->DeclareProperty(
+      "opticalDataDir", fOpticalDataDir,
+      "Directory of the optical_*.txt tables (read only with optical physics)");
+  fMessenger
+      ->DeclareProperty(
+          "surface", fSurfaceMode,
+          "Crystal outer faces: none (Fresnel, photons leave and keep "
+          "propagating), absorb or detect (photons end at the first exit; "
+          "PhotonExit counts the photons reaching the faces, or only the "
+          "detected ones)")
+      .SetCandidates("none absorb detect")
+      .SetStates(G4State_PreInit);
+  fMessenger
+      ->DeclareProperty("surfaceEfficiency", fSurfaceEfficiency,
+                        "Detection probability of the crystal faces in "
+                        "detect mode")
+      .SetStates(G4State_PreInit);
+  fMessenger
+      ->DeclarePropertyWithUnit(
+          "fastShowerMinEnergy", "MeV", fFastShowerMinEnergy,
+          "e-/e+ above this energy are parametrised with /CsI/physics/"
+          "fastShower (/GFlash/flag 0 switches back to full simulation)")
+      .SetStates(G4State_PreInit);
+  // 敏感探测器在 /run/initialize 时按这些参数创建，之后不可再改
+  fMessenger
+      ->DeclareProperty("timeBins", fTimeBinCount,
+                        "Number of time bins per crystal hit (0 = off)")
+      .SetStates(G4State_PreInit);
+  fMessenger
+      ->DeclarePropertyWithUnit("timeBinWidth", "ns", fTimeBinWidth,
+                                "Width of the crystal hit time bins")
+      .SetStates(G4State_PreInit);
+  fMessenger
+      ->DeclarePropertyWithUnit("timeBinStart", "ns", fTimeBinStart,
+                                "Start of the first time bin")
+      .SetStates(G4State_PreInit);
 }
 
 DetectorConstruction::~DetectorConstruction() { delete fMessenger; }
 
 G4VPhysicalVolume *DetectorConstruction::Construct() {
-  // 定义所有材料
-  DefineMaterials();
+  // 几何参数改变后再次调用（/CsI/sweep 之后的 ReinitializeGeometry）：
+  // 先删除上一次的几何；材料、光学属性和 GFlash 区域保留
+  if (fGapLV) {
+    if (fArrayRegion)
+      fArrayRegion->RemoveRootLogicalVolume(fGapLV);
+    G4GeometryManager::GetInstance()->OpenGeometry();
+    G4PhysicalVolumeStore::GetInstance()->Clean();
+    G4LogicalVolumeStore::GetInstance()->Clean();
+    G4SolidStore::GetInstance()->Clean();
+    G4LogicalSkinSurface::CleanSurfaceTable();
+    fGapLV = nullptr;
+  }
+
+  auto physicsList = dynamic_cast<const PhysicsList *>(
+      G4RunManager::GetRunManager()->GetUserPhysicsList());
+  G4bool opticalEnabled = physicsList && physicsList->IsOpticalEnabled();
+  // 材料和光学属性表只在第一次构建时定义，几何重建时沿用
+  if (!fCsI) {
+    // 定义所有材料
+    DefineMaterials();
+
+    // 光学属性表（含闪烁）只在开启光学物理时构建
+    if (opticalEnabled) {
+      auto t0 = std::chrono::steady_clock::now();
+      DefineOpticalProperties();
+      auto t1 = std::chrono::steady_clock::now();
+      G4cout << "[DetectorConstruction] Optical properties built in "
+             << std::chrono::duration<G4double, std::milli>(t1 - t0).count()
+             << " ms" << G4endl;
+    } else {
+      G4cout << "[DetectorConstruction] Optical physics off, no material "
+                "property tables"
+             << G4endl;
+    }
+  }
 
   // 先计算阵列总尺寸
-  G4int nx = 8; // x方向晶体数
-  G4int ny = 8; // y方向晶体数
-  G4int nz = 5; // z方向晶体数
+  G4int nx = CrystalArray::kNx; // x方向晶体数
+  G4int ny = CrystalArray::kNy; // y方向晶体数
+  G4int nz = CrystalArray::kNz; // z方向晶体数
 
   // 阵列总尺寸（晶体尺寸 + 间隙）* 数量
   G4double totalX = nx * crystalSize + (nx - 1) * gap;
@@ -68,6 +214,16 @@ G4VPhysicalVolume *DetectorConstruction::Construct() {
                             totalZ / 2 - 0.1 * mm);
   G4LogicalVolume *gapLV = new G4LogicalVolume(gapBox, gapMat, "Gap");
   new G4PVPlacement(0, G4ThreeVector(), gapLV, "Gap", worldLV, false, 0);
+  fGapLV = gapLV;
+
+  // 快速簇射：整个阵列（而不是单个晶体）作为 GFlash 的包络，
+  // 簇射的纵向/横向包容性按阵列判断
+  if (physicsList && physicsList->IsFastShowerEnabled()) {
+    if (!fArrayRegion)
+      fArrayRegion = new G4Region("CsIArray");
+    gapLV->SetRegion(fArrayRegion);
+    fArrayRegion->AddRootLogicalVolume(gapLV);
+  }
 
   // =========================
   // 2. 创建 CsI 晶体阵列
@@ -80,34 +236,11 @@ G4VPhysicalVolume *DetectorConstruction::Construct() {
   G4LogicalVolume *csiLV = new G4LogicalVolume(csiBox, fCsI, "CsI");
 
   // --- Optical Surface Properties ---
-  // 定义晶体表面的光学性质（例如：抛光表面，或者包裹了反射层）
-  // G4OpticalSurface *opSurface = new G4OpticalSurface("CsISurface");
-  // opSurface->SetType(dielectric_dielectric); // 介质-介质界面
-  // opSurface->SetFinish(
-  //     ground); // 表面处理：ground (磨砂/粗糙) 或 polished (抛光)
-  // opSurface->SetModel(unified);  // 统一模型 (Unified Model)
-  // opSurface->SetSigmaAlpha(0.1); // 表面粗糙度 (弧度)，仅对 ground 有效
-
-  // 定义表面材质属性 (例如反射率)
-  // G4MaterialPropertiesTable *mptSurface = new G4MaterialPropertiesTable();
-  // 假设全反射或者部分反射
-  // 如果是抛光表面在空气中，通常不需要额外设置 REFLECTIVITY，因为 Fresnel
-  // 已经处理了 但如果是包裹了特氟龙(Teflon)等反射层，可以设置 dielectric_metal
-  // 或者 dielectric_dielectric + REFLECTIVITY
-
-  // 示例：设置反射率 (Reflectivity) 和 效率 (Efficiency)
-  // G4double reflectivity[nEntries] = {0.0, 0.0}; // 设为0以允许光子离开
-  // G4double efficiency[nEntries] = {0.0, 0.0}; //
-  // 探测效率（如果是光电倍增管阴极则不为0）
-  // mptSurface->AddProperty("REFLECTIVITY", photonEnergy, reflectivity,
-  // nEntries);
-
-  // opSurface->SetMaterialPropertiesTable(mptSurface);
-
-  // 将光学表面应用到 CsI 逻辑体表面 (Skin Surface)
-  // 这意味着晶体的所有面都具有这种性质
-  // new G4LogicalSkinSurface("CsISkinSurface", csiLV, opSurface);
-  // ----------------------------------
+  // 默认 (none) 没有表面：光子按 Fresnel 折射或全反射，离开晶体后继续在
+  // Gap/World 中传播，可能重新进入其他晶体。absorb/detect 给晶体的所有面
+  // 加上不反射的表面，光子第一次到达表面就终止。
+  if (opticalEnabled && fSurfaceMode != "none")
+    BuildCrystalSurface(csiLV);
 
   // 阵列中心对齐到世界中心
   G4double startX = -totalX / 2 + crystalSize / 2;
@@ -115,6 +248,7 @@ G4VPhysicalVolume *DetectorConstruction::Construct() {
   G4double startZ = -totalZ / 2 + crystalSize / 2;
 
   // 三重循环放置晶体
+  fCrystalCentres.assign(CrystalArray::kNCrystals, G4ThreeVector());
   for (G4int ix = 0; ix < nx; ix++) {
     for (G4int iy = 0; iy < ny; iy++) {
       for (G4int iz = 0; iz < nz; iz++) {
@@ -122,14 +256,13 @@ G4VPhysicalVolume *DetectorConstruction::Construct() {
         G4double posY = startY + iy * (crystalSize + gap);
         G4double posZ = startZ + iz * (crystalSize + gap);
 
-        // 修改 ID 生成规则：XXYYZZ 格式
-        // 例如: 30502 代表 ix=3, iy=5, iz=2
-        G4int copyNo = ix * 10000 + iy * 100 + iz;
+        // copy number 使用连续的晶体索引 0..N-1
+        // （XXYYZZ 编码由 CrystalArray::IndexToCopyNo 导出）
+        G4int index = CrystalArray::EncodeIndex(ix, iy, iz);
+        fCrystalCentres[index] = G4ThreeVector(posX, posY, posZ);
 
-        new G4PVPlacement(0, G4ThreeVector(posX, posY, posZ), csiLV, "CsI",
-                          gapLV, false,
-                          copyNo // 使用新的编码编号
-        );
+        new G4PVPlacement(0, fCrystalCentres[index], csiLV, "CsI", gapLV,
+                          false, index);
       }
     }
   }
@@ -145,6 +278,34 @@ G4VPhysicalVolume *DetectorConstruction::Construct() {
   return worldPV;
 }
 
+void DetectorConstruction::BuildCrystalSurface(G4LogicalVolume *csiLV) {
+  // dielectric_metal + REFLECTIVITY 0：到达表面的光子全部终止，
+  // 其中按 EFFICIENCY 的比例记为 Detection（absorb 模式为 0，只有 Absorption）
+  // SteppingAction 在 absorb 模式下把 Absorption（到达晶体面的光子）、
+  // 在 detect 模式下把 Detection 计入 PhotonExit 列
+  auto surface = new G4OpticalSurface("CsISurface");
+  surface->SetType(dielectric_metal);
+  surface->SetFinish(polished);
+  surface->SetModel(glisur);
+
+  const G4int nEntries = 2;
+  G4double photonEnergy[nEntries] = {1.5 * eV, 4.0 * eV};
+  G4double reflectivity[nEntries] = {0., 0.};
+  G4double efficiency = fSurfaceMode == "detect" ? fSurfaceEfficiency : 0.;
+  G4double efficiencies[nEntries] = {efficiency, efficiency};
+
+  auto mptSurface = new G4MaterialPropertiesTable();
+  mptSurface->AddProperty("REFLECTIVITY", photonEnergy, reflectivity,
+                          nEntries);
+  mptSurface->AddProperty("EFFICIENCY", photonEnergy, efficiencies, nEntries);
+  surface->SetMaterialPropertiesTable(mptSurface);
+
+  // 将光学表面应用到 CsI 逻辑体表面 (Skin Surface)，晶体的所有面都是外表面
+  new G4LogicalSkinSurface("CsISkinSurface", csiLV, surface);
+  G4cout << "[DetectorConstruction] Crystal surfaces: " << fSurfaceMode
+         << " (efficiency " << efficiency << ")" << G4endl;
+}
+
 void DetectorConstruction::SetVisualizationAttributes(G4LogicalVolume *worldLV,
                                                       G4LogicalVolume *gapLV,
                                                       G4LogicalVolume *csiLV) {
@@ -178,12 +339,38 @@ void DetectorConstruction::ConstructSDandField() {
 
   // 检查是否已经存在，避免重复添加
   G4String sdName = "CsISD";
-  if (!sdManager->FindSensitiveDetector(sdName, false)) {
-    DetectorSD *detectorSD = new DetectorSD(sdName, "CsIHitsCollection");
+  G4VSensitiveDetector *detectorSD =
+      sdManager->FindSensitiveDetector(sdName, false);
+  if (!detectorSD) {
+    detectorSD = new DetectorSD(sdName, "CsIHitsCollection",
+                                GetTimeBinCount(), fTimeBinWidth,
+                                fTimeBinStart);
     sdManager->AddNewDetector(detectorSD);
+  }
 
-    // 关键：通过逻辑体名称来设置 SD，而不是指针
-    SetSensitiveDetector("CsI", detectorSD);
+  // 关键：通过逻辑体名称来设置 SD，而不是指针
+  // （几何重建后 SD 已存在，但要挂到新的 CsI 逻辑体上）
+  SetSensitiveDetector("CsI", detectorSD);
+
+  // GFlash 的能量点由 GFlashHitMaker 定位到晶体，交给 DetectorSD
+  // 的 ProcessHits(G4GFlashSpot*)，与完整模拟走同一条 hit 路径
+  if (fArrayRegion && !fastShowerModel) {
+    showerParameterisation = new GFlashHomoShowerParameterisation(fCsI);
+    showerParticleBounds = new GFlashParticleBounds();
+    showerParticleBounds->SetMinEneToParametrise(*G4Electron::Definition(),
+                                                 fFastShowerMinEnergy);
+    showerParticleBounds->SetMinEneToParametrise(*G4Positron::Definition(),
+                                                 fFastShowerMinEnergy);
+    showerHitMaker = new GFlashHitMaker();
+
+    fastShowerModel = new GFlashShowerModel("CsIShowerModel", fArrayRegion);
+    fastShowerModel->SetParameterisation(*showerParameterisation);
+    fastShowerModel->SetParticleBounds(*showerParticleBounds);
+    fastShowerModel->SetHitMaker(*showerHitMaker);
+    fastShowerModel->SetFlagParamOn(1);
+    G4cout << "[DetectorConstruction] GFlash showers above "
+           << fFastShowerMinEnergy / MeV << " MeV in region "
+           << fArrayRegion->GetName() << G4endl;
   }
 }
 
@@ -194,14 +381,6 @@ void DetectorConstruction::DefineMaterials() {
   // 空气材料
   fAir = nist->FindOrBuildMaterial("G4_AIR");
 
-  // 空气的光学属性
-  fMptAir = new G4MaterialPropertiesTable();
-  const G4int nEntriesAir = 2;
-  G4double photonEnergyAir[nEntriesAir] = {2.0 * eV, 4.0 * eV};
-  G4double rIndexAir[nEntriesAir] = {1.0, 1.0};
-  fMptAir->AddProperty("RINDEX", photonEnergyAir, rIndexAir, nEntriesAir);
-  fAir->SetMaterialPropertiesTable(fMptAir);
-
   // 光学硅脂材料
   fOpticalGrease = new G4Material("OpticalGrease", 1.05 * g / cm3, 2);
   G4Element *elSi = nist->FindOrBuildElement("Si");
@@ -209,43 +388,44 @@ void DetectorConstruction::DefineMaterials() {
   fOpticalGrease->AddElement(elSi, 1);
   fOpticalGrease->AddElement(elO, 2);
 
+  // CsI 材料
+  fCsI = nist->FindOrBuildMaterial("G4_CESIUM_IODIDE");
+}
+
+void DetectorConstruction::DefineOpticalProperties() {
+  G4String dir = fOpticalDataDir + "/";
+
+  // 空气的光学属性
+  fMptAir = new G4MaterialPropertiesTable();
+  const G4int nEntriesAir = 2;
+  G4double photonEnergyAir[nEntriesAir] = {1.5 * eV, 4.0 * eV};
+  G4double rIndexAir[nEntriesAir] = {1.0, 1.0};
+  fMptAir->AddProperty("RINDEX", photonEnergyAir, rIndexAir, nEntriesAir);
+  fAir->SetMaterialPropertiesTable(fMptAir);
+
   // 光学硅脂的光学属性
   fMptGrease = new G4MaterialPropertiesTable();
-  const G4int nEntriesGrease = 2;
-  G4double photonEnergyGrease[nEntriesGrease] = {2.0 * eV, 4.0 * eV};
-  G4double rIndexGrease[nEntriesGrease] = {1.5, 1.5};
-  fMptGrease->AddProperty("RINDEX", photonEnergyGrease, rIndexGrease,
-                          nEntriesGrease);
+  AddSpectrum(fMptGrease, "RINDEX", dir + "optical_Grease_RINDEX.txt", 1.,
+              1.5);
   fOpticalGrease->SetMaterialPropertiesTable(fMptGrease);
 
-  // CsI 材料
-  fCsI = nist->FindOrBuildMaterial("G4_CESIUM_IODIDE");
-
-  // CsI 的光学属性
+  // CsI(Tl) 的光学属性：随波长变化的折射率、吸收长度和发射谱
   fMptCsI = new G4MaterialPropertiesTable();
-
-  const G4int nEntries = 2;
-  G4double photonEnergy[nEntries] = {2.0 * eV, 4.0 * eV};
-  G4double rIndex[nEntries] = {1.79, 1.79};
-  fMptCsI->AddProperty("RINDEX", photonEnergy, rIndex, nEntries);
+  AddSpectrum(fMptCsI, "RINDEX", dir + "optical_CsI_RINDEX.txt", 1., 1.79);
+  AddSpectrum(fMptCsI, "ABSLENGTH", dir + "optical_CsI_ABSLENGTH.txt", cm,
+              100. * cm);
+  // 发射谱同时写入新旧两套键名 (Geant4 11 / 10.x)
+  AddSpectrum(fMptCsI, "SCINTILLATIONCOMPONENT1",
+              dir + "optical_CsI_EMISSION.txt", 1., 1.);
+  AddSpectrum(fMptCsI, "FASTCOMPONENT", dir + "optical_CsI_EMISSION.txt", 1.,
+              1.);
 
   fMptCsI->AddConstProperty("SCINTILLATIONYIELD", 54000. / MeV);
   fMptCsI->AddConstProperty("RESOLUTIONSCALE", 1.0);
   fMptCsI->AddConstProperty("SCINTILLATIONTIMECONSTANT1", 1000. * ns);
-
-  G4double component[nEntries] = {1.0, 1.0};
-  fMptCsI->AddProperty("SCINTILLATIONCOMPONENT1", photonEnergy, component,
-                       nEntries);
-
   fMptCsI->AddConstProperty("FASTTIMECONSTANT", 1000. * ns);
   fMptCsI->AddConstProperty("SLOWTIMECONSTANT", 1000. * ns);
   fMptCsI->AddConstProperty("YIELDRATIO", 1.0);
 
-  G4double fastComponent[nEntries] = {1.0, 1.0};
-  fMptCsI->AddProperty("FASTCOMPONENT", photonEnergy, fastComponent, nEntries);
-
-  G4double absLength[nEntries] = {100. * cm, 100. * cm};
-  fMptCsI->AddProperty("ABSLENGTH", photonEnergy, absLength, nEntries);
-
   fCsI->SetMaterialPropertiesTable(fMptCsI);
 }
@@ -1,17 +1,25 @@
 // DetectorSD.cc
 
 #include "DetectorSD.hh"
+#include "BenchmarkTimer.hh"
+#include "CrystalArray.hh"
+#include "G4RunManager.hh"
+#include "G4GFlashSpot.hh"
 #include "G4SDManager.hh"
 #include "G4Step.hh"
 #include "G4VProcess.hh"
 #include "G4ios.hh"
+#include "TrackingAction.hh"
+#include <algorithm>
 
 G4ThreadLocal G4Allocator<CsIHit> *CsIHitAllocator = 0;
 
 CsIHit::CsIHit()
     : G4VHit(), fTrackID(-1), fChamberNb(-1), fEdep(0.), fPos(G4ThreeVector()),
       fTime(0.), fPDG(0), fParentID(-1), fMomentumDirection(G4ThreeVector()),
-      fKineticEnergy(0.), fCreatorProcess(""), fTrackLength(0.) {}
+      fKineticEnergy(0.), fCreatorProcess(""), fTrackLength(0.) {
+  std::fill(fPrimaryEdep, fPrimaryEdep + kMaxPrimaries, 0.);
+}
 CsIHit::~CsIHit() {}
 CsIHit::CsIHit(const CsIHit &right) : G4VHit() {
   fTrackID = right.fTrackID;
@@ -25,6 +33,9 @@ CsIHit::CsIHit(const CsIHit &right) : G4VHit() {
   fKineticEnergy = right.fKineticEnergy;
   fCreatorProcess = right.fCreatorProcess;
   fTrackLength = right.fTrackLength;
+  fTimeBins = right.fTimeBins;
+  std::copy(right.fPrimaryEdep, right.fPrimaryEdep + kMaxPrimaries,
+            fPrimaryEdep);
 }
 const CsIHit &CsIHit::operator=(const CsIHit &right) {
   fTrackID = right.fTrackID;
@@ -38,6 +49,9 @@ const CsIHit &CsIHit::operator=(const CsIHit &right) {
   fKineticEnergy = right.fKineticEnergy;
   fCreatorProcess = right.fCreatorProcess;
   fTrackLength = right.fTrackLength;
+  fTimeBins = right.fTimeBins;
+  std::copy(right.fPrimaryEdep, right.fPrimaryEdep + kMaxPrimaries,
+            fPrimaryEdep);
   return *this;
 }
 int CsIHit::operator==(const CsIHit &right) const {
@@ -46,8 +60,12 @@ int CsIHit::operator==(const CsIHit &right) const {
 void CsIHit::Draw() {}
 void CsIHit::Print() {}
 
-DetectorSD::DetectorSD(const G4String &name, const G4String &hitsCollectionName)
-    : G4VSensitiveDetector(name), fHitsCollection(nullptr) {
+DetectorSD::DetectorSD(const G4String &name, const G4String &hitsCollectionName,
+                       G4int nTimeBins, G4double binWidth, G4double binStart)
+    : G4VSensitiveDetector(name), fHitsCollection(nullptr),
+      fNTimeBins(nTimeBins > 0 && binWidth > 0. ? nTimeBins : 0),
+      fTimeBinWidth(binWidth), fTimeBinStart(binStart),
+      fHitOfCrystal(CrystalArray::kNCrystals, -1), fTrackingAction(nullptr) {
   collectionName.insert(hitsCollectionName);
 }
 
@@ -61,9 +79,12 @@ void DetectorSD::Initialize(G4HCofThisEvent *hce) {
   // Add this collection in hce
   G4int hcID = G4SDManager::GetSDMpointer()->GetCollectionID(collectionName[0]);
   hce->AddHitsCollection(hcID, fHitsCollection);
+
+  std::fill(fHitOfCrystal.begin(), fHitOfCrystal.end(), -1);
 }
 
 G4bool DetectorSD::ProcessHits(G4Step *step, G4TouchableHistory *) {
+  CSI_BENCH_SCOPE(kProcessHits);
   G4double edep = step->GetTotalEnergyDeposit();
   if (edep == 0.)
     return false;
@@ -71,49 +92,97 @@ G4bool DetectorSD::ProcessHits(G4Step *step, G4TouchableHistory *) {
   G4StepPoint *preStepPoint = step->GetPreStepPoint();
   G4TouchableHistory *touchable =
       (G4TouchableHistory *)(preStepPoint->GetTouchable());
-  G4int copyNo = touchable->GetReplicaNumber(0);
+  // copy number 就是连续晶体索引
+  G4int index = touchable->GetReplicaNumber(0);
+
+  AddDeposit(index, edep, step->GetTrack(), preStepPoint->GetGlobalTime(),
+             preStepPoint->GetPosition(),
+             preStepPoint->GetMomentumDirection(),
+             preStepPoint->GetKineticEnergy(), step->GetStepLength());
+  return true;
+}
 
+G4bool DetectorSD::ProcessHits(G4GFlashSpot *spot, G4TouchableHistory *) {
+  CSI_BENCH_SCOPE(kProcessHits);
+  G4double edep = spot->GetEnergySpot()->GetEnergy();
+  if (edep == 0.)
+    return false;
+
+  // GFlashHitMaker 已把能量点定位到晶体（落在 Gap 中的点不会到这里）
+  G4int index = spot->GetTouchableHandle()->GetReplicaNumber(0);
+
+  // 能量点没有自己的时间、方向和步长：取开始参数化的那条径迹的值
+  const G4Track *track = spot->GetOriginatorTrack()->GetPrimaryTrack();
+  AddDeposit(index, edep, track, track->GetGlobalTime(),
+             spot->GetEnergySpot()->GetPosition(),
+             track->GetMomentumDirection(), track->GetKineticEnergy(), 0.);
+  return true;
+}
+
+void DetectorSD::AddDeposit(G4int index, G4double edep, const G4Track *track,
+                            G4double time, const G4ThreeVector &position,
+                            const G4ThreeVector &direction,
+                            G4double kineticEnergy, G4double stepLength) {
   // Check if this crystal already has a hit
   G4int nHits = fHitsCollection->entries();
-  CsIHit *hit = nullptr;
-  for (G4int i = 0; i < nHits; i++) {
-    if ((*fHitsCollection)[i]->GetChamberNb() == copyNo) {
-      hit = (*fHitsCollection)[i];
-      break;
-    }
-  }
+  CsIHit *hit = fHitOfCrystal[index] >= 0
+                    ? (*fHitsCollection)[fHitOfCrystal[index]]
+                    : nullptr;
 
   if (hit) {
     // Add energy to existing hit
     hit->AddEdep(edep);
     // Add step length to track length
-    hit->AddTrackLength(step->GetStepLength());
+    hit->AddTrackLength(stepLength);
     // Keep the earliest time
-    if (preStepPoint->GetGlobalTime() < hit->GetTime()) {
-      hit->SetTime(preStepPoint->GetGlobalTime());
+    if (time < hit->GetTime()) {
+      hit->SetTime(time);
     }
   } else {
     // Create new hit
     hit = new CsIHit();
-    hit->SetChamberNb(copyNo);
+    hit->SetChamberNb(index);
     hit->SetEdep(edep);
-    hit->SetPos(preStepPoint->GetPosition());
-    hit->SetTrackID(step->GetTrack()->GetTrackID());
-    hit->SetTime(preStepPoint->GetGlobalTime());
-    hit->SetPDG(step->GetTrack()->GetDefinition()->GetPDGEncoding());
-    hit->SetParentID(step->GetTrack()->GetParentID());
-    hit->SetMomentumDirection(preStepPoint->GetMomentumDirection());
-    hit->SetKineticEnergy(preStepPoint->GetKineticEnergy());
-    hit->SetTrackLength(step->GetStepLength());
-    const G4VProcess *creatorProcess = step->GetTrack()->GetCreatorProcess();
+    hit->SetPos(position);
+    hit->SetTrackID(track->GetTrackID());
+    hit->SetTime(time);
+    hit->SetPDG(track->GetDefinition()->GetPDGEncoding());
+    hit->SetParentID(track->GetParentID());
+    hit->SetMomentumDirection(direction);
+    hit->SetKineticEnergy(kineticEnergy);
+    hit->SetTrackLength(stepLength);
+    if (fNTimeBins > 0) {
+      hit->SetTimeBinCount(fNTimeBins);
+    }
+    const G4VProcess *creatorProcess = track->GetCreatorProcess();
     if (creatorProcess) {
       hit->SetCreatorProcess(creatorProcess->GetProcessName());
     } else {
       hit->SetCreatorProcess("Primary");
     }
     fHitsCollection->insert(hit);
+    fHitOfCrystal[index] = nHits;
+  }
+
+  // 按径迹所属的初级粒子累加（查平铺表，O(1)）
+  if (!fTrackingAction)
+    fTrackingAction = static_cast<const TrackingAction *>(
+        G4RunManager::GetRunManager()->GetUserTrackingAction());
+  hit->AddPrimaryEdep(
+      fTrackingAction ? fTrackingAction->GetPrimaryIndex(track->GetTrackID())
+                      : 0,
+      edep);
+
+  if (fNTimeBins > 0) {
+    // 窗口之前的沉积计入第一个箱，之后的计入最后一个箱
+    G4double x = (time - fTimeBinStart) / fTimeBinWidth;
+    G4int bin = 0;
+    if (x >= fNTimeBins - 1)
+      bin = fNTimeBins - 1;
+    else if (x > 0.)
+      bin = static_cast<G4int>(x);
+    hit->AddTimeBinEdep(bin, edep);
   }
-  return true;
 }
 
 void DetectorSD::EndOfEvent(G4HCofThisEvent *) {
@@ -1,22 +1,55 @@
 #include "EventAction.hh"
+#include "BenchmarkTimer.hh"
+#include "CrystalArray.hh"
+#include "CrystalClusterer.hh"
+#include "CsIDigitizer.hh"
+#include "DetectorConstruction.hh"
 #include "DetectorSD.hh"
 #include "RunAction.hh"
 #include "SteppingAction.hh"
+#include "TrackingAction.hh"
+#include "WaveformSynthesizer.hh"
 
+#include "G4DigiManager.hh"
 #include "G4Event.hh"
 #include "G4RunManager.hh"
 #include "G4SDManager.hh"
 #include "G4SystemOfUnits.hh"
 #include "g4root.hh"
 #include <G4ios.hh>
+#include <algorithm>
 
-EventAction::EventAction() : G4UserEventAction(), fHCID(-1) {}
+EventAction::EventAction()
+    : G4UserEventAction(), fHCID(-1), fDCID(-1), fDigitizer(nullptr),
+      fWaveform(nullptr), fClusterer(nullptr) {
+  // 每个线程一个数字化模块（G4DigiManager 是线程局部的）
+  fDigitizer = new CsIDigitizer("CsIDigitizer");
+  G4DigiManager::GetDMpointer()->AddNewModule(fDigitizer);
 
-EventAction::~EventAction() {}
+  fWaveform = new WaveformSynthesizer();
+  fClusterer = new CrystalClusterer();
+}
+
+EventAction::~EventAction() {
+  delete fWaveform;
+  delete fClusterer;
+}
 
-void EventAction::BeginOfEventAction(const G4Event *) {}
+void EventAction::BeginOfEventAction(const G4Event *) {
+  auto runAction = static_cast<const RunAction *>(
+      G4RunManager::GetRunManager()->GetUserRunAction());
+  const_cast<RunAction *>(runAction)->GetMemoryMonitor().BeginEvent();
+  const_cast<RunAction *>(runAction)->GetWatchdog().BeginEvent();
+
+  auto trackingAction = static_cast<const TrackingAction *>(
+      G4RunManager::GetRunManager()->GetUserTrackingAction());
+  if (trackingAction)
+    const_cast<TrackingAction *>(trackingAction)->GetTruthRecord().Clear();
+}
 
 void EventAction::EndOfEventAction(const G4Event *event) {
+  CSI_BENCH_SCOPE(kEventAction);
+  CSI_BENCH_COUNT(kEvents, 1);
   // Get hits collection ID (only once)
   if (fHCID == -1) {
     fHCID = G4SDManager::GetSDMpointer()->GetCollectionID("CsIHitsCollection");
@@ -31,9 +64,6 @@ void EventAction::EndOfEventAction(const G4Event *event) {
   if (!hitsCollection)
     return;
 
-  // Get analysis manager
-  auto analysisManager = G4AnalysisManager::Instance();
-
   // Get RunAction to access vectors
   auto runAction = static_cast<const RunAction *>(
       G4RunManager::GetRunManager()->GetUserRunAction());
@@ -53,7 +83,10 @@ void EventAction::EndOfEventAction(const G4Event *event) {
   // vector 引用， 并在 EventAction 中获取它。
 
   RunAction *nonConstRunAction = const_cast<RunAction *>(runAction);
+  // 异步输出时取一行空的 EventRecord（写线程跟不上时在这里等待）
+  nonConstRunAction->BeginRow();
   auto &crystalIDs = nonConstRunAction->GetCrystalIDs();
+  auto &crystalIndices = nonConstRunAction->GetCrystalIndices();
   auto &crystalEdeps = nonConstRunAction->GetCrystalEdeps();
   auto &crystalTimes = nonConstRunAction->GetCrystalTimes();
   auto &crystalPosX = nonConstRunAction->GetCrystalPosX();
@@ -68,6 +101,8 @@ void EventAction::EndOfEventAction(const G4Event *event) {
   auto &crystalKineticEnergy = nonConstRunAction->GetCrystalKineticEnergy();
   auto &crystalProcessIDs = nonConstRunAction->GetCrystalProcessIDs();
   auto &crystalTrackLength = nonConstRunAction->GetCrystalTrackLength();
+  auto &crystalTimeBinEdeps = nonConstRunAction->GetCrystalTimeBinEdeps();
+  auto &crystalPrimaryEdeps = nonConstRunAction->GetCrystalPrimaryEdeps();
 
   // Primary Particle Vectors
   auto &primaryPDG = nonConstRunAction->GetPrimaryPDG();
@@ -85,6 +120,7 @@ void EventAction::EndOfEventAction(const G4Event *event) {
 
   // Clear vectors
   crystalIDs.clear();
+  crystalIndices.clear();
   crystalEdeps.clear();
   crystalTimes.clear();
   crystalPosX.clear();
@@ -99,6 +135,8 @@ void EventAction::EndOfEventAction(const G4Event *event) {
   crystalKineticEnergy.clear();
   crystalProcessIDs.clear();
   crystalTrackLength.clear();
+  crystalTimeBinEdeps.clear();
+  crystalPrimaryEdeps.clear();
 
   primaryPDG.clear();
   primaryEnergy.clear();
@@ -112,8 +150,18 @@ void EventAction::EndOfEventAction(const G4Event *event) {
   photonExitCrystalIDs.clear();
   photonExitCounts.clear();
 
+  // 只写直方图时跳过逐 hit 的 ntuple 列
+  G4bool writeNtuple = nonConstRunAction->IsNtupleEnabled();
+  G4bool writeHitColumns = nonConstRunAction->IsHitColumnsEnabled();
+  G4int timeBinCount = nonConstRunAction->GetTimeBinCount();
+  // 有界内存模式下每个事件的 hit、digi、波形、簇列最多写 maxHitEntries 项
+  // （0 为不限）
+  MemoryMonitor &memoryMonitor = nonConstRunAction->GetMemoryMonitor();
+  size_t maxHitEntries = memoryMonitor.GetMaxHitEntries();
+  G4bool truncated = false;
+
   // Fill Primary Particles
-  G4int nVertex = event->GetNumberOfPrimaryVertex();
+  G4int nVertex = writeNtuple ? event->GetNumberOfPrimaryVertex() : 0;
   for (G4int i = 0; i < nVertex; i++) {
     G4PrimaryVertex *vertex = event->GetPrimaryVertex(i);
     G4double x = vertex->GetX0();
@@ -134,17 +182,33 @@ void EventAction::EndOfEventAction(const G4Event *event) {
     }
   }
 
+  // 每个 hit 写出的初级粒子份额数
+  G4int nPrimaryShares = 0;
+  for (G4int i = 0; i < event->GetNumberOfPrimaryVertex(); i++)
+    nPrimaryShares += event->GetPrimaryVertex(i)->GetNumberOfParticle();
+  nPrimaryShares = std::min(nPrimaryShares, CsIHit::kMaxPrimaries);
+
   G4double totalEdep = 0.;
+  G4int nFired = 0; // 有能量沉积的 hit，含截断掉的
   G4int nHits = hitsCollection->entries();
+  CSI_BENCH_COUNT(kHits, nHits);
 
   for (G4int i = 0; i < nHits; i++) {
     auto hit = (*hitsCollection)[i];
     G4double edep = hit->GetEdep();
     if (edep > 0.) {
       totalEdep += edep;
-      crystalIDs.push_back(hit->GetChamberNb());
+      nFired++;
+      if (maxHitEntries > 0 && crystalIndices.size() >= maxHitEntries) {
+        truncated = true;
+        continue;
+      }
+      crystalIndices.push_back(hit->GetChamberNb());
+      crystalIDs.push_back(CrystalArray::IndexToCopyNo(hit->GetChamberNb()));
       crystalEdeps.push_back(edep);
       crystalTimes.push_back(hit->GetTime());
+      if (!writeHitColumns)
+        continue;
       crystalPosX.push_back(hit->GetPos().x());
       crystalPosY.push_back(hit->GetPos().y());
       crystalPosZ.push_back(hit->GetPos().z());
@@ -158,6 +222,13 @@ void EventAction::EndOfEventAction(const G4Event *event) {
       crystalProcessIDs.push_back(
           nonConstRunAction->GetProcessID(hit->GetCreatorProcess()));
       crystalTrackLength.push_back(hit->GetTrackLength());
+      for (G4int k = 0; k < nPrimaryShares; k++)
+        crystalPrimaryEdeps.push_back(hit->GetPrimaryEdep(k));
+      if (timeBinCount > 0 && hit->GetTimeBins()) {
+        crystalTimeBinEdeps.insert(crystalTimeBinEdeps.end(),
+                                   hit->GetTimeBins(),
+                                   hit->GetTimeBins() + timeBinCount);
+      }
     }
   }
 
@@ -166,21 +237,160 @@ void EventAction::EndOfEventAction(const G4Event *event) {
       const_cast<SteppingAction *>(static_cast<const SteppingAction *>(
           G4RunManager::GetRunManager()->GetUserSteppingAction()));
   const auto &exitCounts = steppingAction->GetPhotonExitCounts();
-  // G4cout << "Photon exit counts: " << exitCounts.size() << "\n";
-  for (const auto &pair : exitCounts) {
-    photonExitCrystalIDs.push_back(pair.first);
-    photonExitCounts.push_back(pair.second);
+  for (G4int index : steppingAction->GetExitedCrystals()) {
+    photonExitCrystalIDs.push_back(CrystalArray::IndexToCopyNo(index));
+    photonExitCounts.push_back(exitCounts[index]);
   }
-  G4cout << "Filled PhotonExitCrystalIDs with " << photonExitCrystalIDs.size()
-         << " entries.\n";
   // Reset counts for next event
   steppingAction->ResetCounts();
 
-  // Fill Ntuple
-  analysisManager->FillNtupleIColumn(0, event->GetEventID());
-  analysisManager->FillNtupleDColumn(1, totalEdep);
-  analysisManager->FillNtupleIColumn(2, crystalIDs.size());
+  // Digitization: crystal energy -> ADC/TDC
+  if (nonConstRunAction->IsDigiEnabled()) {
+    auto &digiCrystalIDs = nonConstRunAction->GetDigiCrystalIDs();
+    auto &digiADCs = nonConstRunAction->GetDigiADCs();
+    auto &digiTDCs = nonConstRunAction->GetDigiTDCs();
+    digiCrystalIDs.clear();
+    digiADCs.clear();
+    digiTDCs.clear();
+
+    auto digiManager = G4DigiManager::GetDMpointer();
+    digiManager->Digitize("CsIDigitizer");
+    if (fDCID == -1)
+      fDCID = digiManager->GetDigiCollectionID("CsIDigiCollection");
+    auto digitsCollection = static_cast<const CsIDigitsCollection *>(
+        digiManager->GetDigiCollection(fDCID));
+    if (digitsCollection) {
+      G4int nDigis = digitsCollection->entries();
+      for (G4int i = 0; i < nDigis; i++) {
+        if (maxHitEntries > 0 && digiCrystalIDs.size() >= maxHitEntries) {
+          truncated = true;
+          break;
+        }
+        auto digi = (*digitsCollection)[i];
+        digiCrystalIDs.push_back(digi->GetCrystalID());
+        digiADCs.push_back(digi->GetADC());
+        digiTDCs.push_back(digi->GetTDC());
+      }
+    }
+  }
+
+  // Waveform synthesis for every fired crystal
+  if (nonConstRunAction->IsWaveformEnabled()) {
+    auto &waveformCrystalIDs = nonConstRunAction->GetWaveformCrystalIDs();
+    auto &waveformSamples = nonConstRunAction->GetWaveformSamples();
+    waveformCrystalIDs.clear();
+    waveformSamples.clear();
+
+    auto detector = static_cast<const DetectorConstruction *>(
+        G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+    fWaveform->Prepare();
+    G4int nSamples = fWaveform->GetNSamples();
+    fWaveformInput.resize(nSamples);
+    for (G4int i = 0; i < nHits; i++) {
+      auto hit = (*hitsCollection)[i];
+      if (hit->GetEdep() <= 0.)
+        continue;
+      if (maxHitEntries > 0 && waveformCrystalIDs.size() >= maxHitEntries) {
+        truncated = true;
+        break;
+      }
+      std::fill(fWaveformInput.begin(), fWaveformInput.end(), 0.f);
+      const G4float *timeBins = hit->GetTimeBins();
+      if (timeBins && detector) {
+        // 有时间分箱历史时按箱中心时间逐箱加入
+        for (G4int b = 0; b < detector->GetTimeBinCount(); b++) {
+          if (timeBins[b] == 0.f)
+            continue;
+          G4double t = detector->GetTimeBinStart() +
+                       (b + 0.5) * detector->GetTimeBinWidth();
+          fWaveform->AddDeposit(fWaveformInput, t, timeBins[b]);
+        }
+      } else {
+        fWaveform->AddDeposit(fWaveformInput, hit->GetTime(),
+                              hit->GetEdep());
+      }
+
+      size_t offset = waveformSamples.size();
+      waveformSamples.resize(offset + nSamples);
+      fWaveform->Synthesize(fWaveformInput.data(), &waveformSamples[offset]);
+      waveformCrystalIDs.push_back(
+          CrystalArray::IndexToCopyNo(hit->GetChamberNb()));
+    }
+  }
+
+  // Cluster reconstruction over the fired crystals
+  if (nonConstRunAction->IsClusterEnabled()) {
+    auto &clusterEnergy = nonConstRunAction->GetClusterEnergy();
+    auto &clusterPosX = nonConstRunAction->GetClusterPosX();
+    auto &clusterPosY = nonConstRunAction->GetClusterPosY();
+    auto &clusterPosZ = nonConstRunAction->GetClusterPosZ();
+    auto &clusterTime = nonConstRunAction->GetClusterTime();
+    auto &clusterSize = nonConstRunAction->GetClusterSize();
+    auto &clusterSeedID = nonConstRunAction->GetClusterSeedID();
+    clusterEnergy.clear();
+    clusterPosX.clear();
+    clusterPosY.clear();
+    clusterPosZ.clear();
+    clusterTime.clear();
+    clusterSize.clear();
+    clusterSeedID.clear();
+
+    fClusterer->Prepare();
+    for (size_t i = 0; i < crystalIndices.size(); i++)
+      fClusterer->AddDeposit(crystalIndices[i], crystalEdeps[i],
+                             crystalTimes[i]);
+    fClusterer->Reconstruct();
+    for (const auto &cluster : fClusterer->GetClusters()) {
+      if (maxHitEntries > 0 && clusterEnergy.size() >= maxHitEntries) {
+        truncated = true;
+        break;
+      }
+      clusterEnergy.push_back(cluster.energy);
+      clusterPosX.push_back(cluster.centroid.x());
+      clusterPosY.push_back(cluster.centroid.y());
+      clusterPosZ.push_back(cluster.centroid.z());
+      clusterTime.push_back(cluster.time);
+      clusterSize.push_back(cluster.size);
+      clusterSeedID.push_back(cluster.seedCopyNo);
+    }
+  }
+
+  // MC truth of significant secondaries (collected by the TrackingAction)
+  if (nonConstRunAction->IsTruthEnabled()) {
+    auto trackingAction = static_cast<const TrackingAction *>(
+        G4RunManager::GetRunManager()->GetUserTrackingAction());
+    const TruthRecord &truth =
+        const_cast<TrackingAction *>(trackingAction)->GetTruthRecord();
+    EventRecord &row = nonConstRunAction->GetRow();
+    row.truthTrackID.assign(truth.trackID.begin(), truth.trackID.end());
+    row.truthParentID.assign(truth.parentID.begin(), truth.parentID.end());
+    row.truthPDG.assign(truth.pdg.begin(), truth.pdg.end());
+    row.truthProcessID.assign(truth.processID.begin(), truth.processID.end());
+    row.truthEnergy.assign(truth.energy.begin(), truth.energy.end());
+    row.truthPosX.assign(truth.posX.begin(), truth.posX.end());
+    row.truthPosY.assign(truth.posY.begin(), truth.posY.end());
+    row.truthPosZ.assign(truth.posZ.begin(), truth.posZ.end());
+    row.truthTime.assign(truth.time.begin(), truth.time.end());
+  }
+
+  // 重要性抽样的事件权重取第一个顶点的权重
+  G4double eventWeight = 1.;
+  if (event->GetNumberOfPrimaryVertex() > 0)
+    eventWeight = event->GetPrimaryVertex(0)->GetWeight();
+
+  memoryMonitor.EndEvent(nHits, nonConstRunAction->GetNtupleRowBytes(),
+                         truncated);
+  nonConstRunAction->GetWatchdog().EndEvent();
+
+  // 从这里到函数结束都计入 AnalysisFill
+  CSI_BENCH_SCOPE(kAnalysisFill);
+
+  // Online histograms (merged across threads at Write) are filled from the
+  // finished row
+  // HitCount 与 TotalEdep 一样包含全部 hit，截断只影响 vector 列
+  nonConstRunAction->EndRow(event->GetEventID(), totalEdep, nFired,
+                            eventWeight, truncated);
 
-  // vector columns are automatically filled because they are bound by reference
-  analysisManager->AddNtupleRow();
+  // 检查点放在事件的最后：保存的随机数状态正好是下一个事件开始时的状态
+  nonConstRunAction->CheckpointIfDue(event->GetEventID());
 }
@@ -0,0 +1,174 @@
+// EventRecord.cc
+#include "EventRecord.hh"
+
+namespace {
+// 按 capacity 计：clear() 之后保留的缓冲同样占着内存
+template <typename T> G4long VectorBytes(const std::vector<T> &v) {
+  return v.capacity() * sizeof(T);
+}
+} // namespace
+
+void EventRecord::Clear() {
+  eventID = 0;
+  totalEdep = 0.;
+  hitCount = 0;
+  eventWeight = 1.;
+  watchdogFlags = 0;
+  configIndex = 0;
+  truncated = 0;
+  crystalIDs.clear();
+  crystalIndices.clear();
+  crystalEdeps.clear();
+  crystalTimes.clear();
+  crystalPosX.clear();
+  crystalPosY.clear();
+  crystalPosZ.clear();
+  crystalPDGs.clear();
+  crystalTrackIDs.clear();
+  crystalParentIDs.clear();
+  crystalDirX.clear();
+  crystalDirY.clear();
+  crystalDirZ.clear();
+  crystalKineticEnergy.clear();
+  crystalProcessIDs.clear();
+  crystalTrackLength.clear();
+  crystalTimeBinEdeps.clear();
+  crystalPrimaryEdeps.clear();
+  primaryPDG.clear();
+  primaryEnergy.clear();
+  primaryPosX.clear();
+  primaryPosY.clear();
+  primaryPosZ.clear();
+  primaryDirX.clear();
+  primaryDirY.clear();
+  primaryDirZ.clear();
+  photonExitCrystalIDs.clear();
+  photonExitCounts.clear();
+  digiCrystalIDs.clear();
+  digiADCs.clear();
+  digiTDCs.clear();
+  waveformCrystalIDs.clear();
+  waveformSamples.clear();
+  clusterEnergy.clear();
+  clusterPosX.clear();
+  clusterPosY.clear();
+  clusterPosZ.clear();
+  clusterTime.clear();
+  clusterSize.clear();
+  clusterSeedID.clear();
+  truthTrackID.clear();
+  truthParentID.clear();
+  truthPDG.clear();
+  truthProcessID.clear();
+  truthEnergy.clear();
+  truthPosX.clear();
+  truthPosY.clear();
+  truthPosZ.clear();
+  truthTime.clear();
+}
+
+void EventRecord::Swap(EventRecord &other) {
+  std::swap(eventID, other.eventID);
+  std::swap(totalEdep, other.totalEdep);
+  std::swap(hitCount, other.hitCount);
+  std::swap(eventWeight, other.eventWeight);
+  std::swap(watchdogFlags, other.watchdogFlags);
+  std::swap(configIndex, other.configIndex);
+  std::swap(truncated, other.truncated);
+  crystalIDs.swap(other.crystalIDs);
+  crystalIndices.swap(other.crystalIndices);
+  crystalEdeps.swap(other.crystalEdeps);
+  crystalTimes.swap(other.crystalTimes);
+  crystalPosX.swap(other.crystalPosX);
+  crystalPosY.swap(other.crystalPosY);
+  crystalPosZ.swap(other.crystalPosZ);
+  crystalPDGs.swap(other.crystalPDGs);
+  crystalTrackIDs.swap(other.crystalTrackIDs);
+  crystalParentIDs.swap(other.crystalParentIDs);
+  crystalDirX.swap(other.crystalDirX);
+  crystalDirY.swap(other.crystalDirY);
+  crystalDirZ.swap(other.crystalDirZ);
+  crystalKineticEnergy.swap(other.crystalKineticEnergy);
+  crystalProcessIDs.swap(other.crystalProcessIDs);
+  crystalTrackLength.swap(other.crystalTrackLength);
+  crystalTimeBinEdeps.swap(other.crystalTimeBinEdeps);
+  crystalPrimaryEdeps.swap(other.crystalPrimaryEdeps);
+  primaryPDG.swap(other.primaryPDG);
+  primaryEnergy.swap(other.primaryEnergy);
+  primaryPosX.swap(other.primaryPosX);
+  primaryPosY.swap(other.primaryPosY);
+  primaryPosZ.swap(other.primaryPosZ);
+  primaryDirX.swap(other.primaryDirX);
+  primaryDirY.swap(other.primaryDirY);
+  primaryDirZ.swap(other.primaryDirZ);
+  photonExitCrystalIDs.swap(other.photonExitCrystalIDs);
+  photonExitCounts.swap(other.photonExitCounts);
+  digiCrystalIDs.swap(other.digiCrystalIDs);
+  digiADCs.swap(other.digiADCs);
+  digiTDCs.swap(other.digiTDCs);
+  waveformCrystalIDs.swap(other.waveformCrystalIDs);
+  waveformSamples.swap(other.waveformSamples);
+  clusterEnergy.swap(other.clusterEnergy);
+  clusterPosX.swap(other.clusterPosX);
+  clusterPosY.swap(other.clusterPosY);
+  clusterPosZ.swap(other.clusterPosZ);
+  clusterTime.swap(other.clusterTime);
+  clusterSize.swap(other.clusterSize);
+  clusterSeedID.swap(other.clusterSeedID);
+  truthTrackID.swap(other.truthTrackID);
+  truthParentID.swap(other.truthParentID);
+  truthPDG.swap(other.truthPDG);
+  truthProcessID.swap(other.truthProcessID);
+  truthEnergy.swap(other.truthEnergy);
+  truthPosX.swap(other.truthPosX);
+  truthPosY.swap(other.truthPosY);
+  truthPosZ.swap(other.truthPosZ);
+  truthTime.swap(other.truthTime);
+}
+
+G4long EventRecord::Bytes() const {
+  return VectorBytes(crystalIDs) +
+         VectorBytes(crystalIndices) +
+         VectorBytes(crystalEdeps) +
+         VectorBytes(crystalTimes) +
+         VectorBytes(crystalPosX) +
+         VectorBytes(crystalPosY) +
+         VectorBytes(crystalPosZ) +
+         VectorBytes(crystalPDGs) +
+         VectorBytes(crystalTrackIDs) +
+         VectorBytes(crystalParentIDs) +
+         VectorBytes(crystalDirX) +
+         VectorBytes(crystalDirY) +
+         VectorBytes(crystalDirZ) +
+         VectorBytes(crystalKineticEnergy) +
+         VectorBytes(crystalProcessIDs) +
+         VectorBytes(crystalTrackLength) +
+         VectorBytes(crystalTimeBinEdeps) +
+         VectorBytes(crystalPrimaryEdeps) +
+         VectorBytes(primaryPDG) +
+         VectorBytes(primaryEnergy) +
+         VectorBytes(primaryPosX) +
+         VectorBytes(primaryPosY) +
+         VectorBytes(primaryPosZ) +
+         VectorBytes(primaryDirX) +
+         VectorBytes(primaryDirY) +
+         VectorBytes(primaryDirZ) +
+         VectorBytes(photonExitCrystalIDs) +
+         VectorBytes(photonExitCounts) +
+         VectorBytes(digiCrystalIDs) +
+         VectorBytes(digiADCs) +
+         VectorBytes(digiTDCs) +
+         VectorBytes(waveformCrystalIDs) +
+         VectorBytes(waveformSamples) +
+         VectorBytes(clusterEnergy) +
+         VectorBytes(clusterPosX) +
+         VectorBytes(clusterPosY) +
+         VectorBytes(clusterPosZ) +
+         VectorBytes(clusterTime) +
+         VectorBytes(clusterSize) +
+         VectorBytes(clusterSeedID) + VectorBytes(truthTrackID) +
+         VectorBytes(truthParentID) + VectorBytes(truthPDG) +
+         VectorBytes(truthProcessID) + VectorBytes(truthEnergy) +
+         VectorBytes(truthPosX) + VectorBytes(truthPosY) +
+         VectorBytes(truthPosZ) + VectorBytes(truthTime);
+}
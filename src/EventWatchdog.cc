@@ -0,0 +1,135 @@
+// EventWatchdog.cc
+#include "EventWatchdog.hh"
+#include "G4AutoLock.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4RunManager.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+
+namespace {
+EventWatchdog::Counts &MergedCounts() {
+  static EventWatchdog::Counts counts;
+  return counts;
+}
+
+G4Mutex mergeMutex = G4MUTEX_INITIALIZER;
+
+// 读时钟比一步本身还贵，每 1024 步读一次
+constexpr G4int kClockInterval = 1024;
+
+G4double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<G4double>(std::chrono::steady_clock::now() -
+                                         start)
+      .count();
+}
+} // namespace
+
+EventWatchdog::EventWatchdog()
+    : fMessenger(nullptr), fMaxPhotonSteps(0), fMaxGlobalTime(0.),
+      fMaxEventTime(0.), fEventFlags(0), fStepsSinceClock(0) {
+  fMessenger = new G4GenericMessenger(this, "/CsI/watchdog/",
+                                      "Limits for runaway events");
+  fMessenger->DeclareProperty(
+      "maxPhotonSteps", fMaxPhotonSteps,
+      "Kill optical photons after this many steps (0 = no limit)");
+  fMessenger->DeclarePropertyWithUnit(
+      "maxGlobalTime", "ns", fMaxGlobalTime,
+      "Kill tracks whose global time exceeds this (0 = no limit)");
+  fMessenger->DeclarePropertyWithUnit(
+      "maxEventTime", "s", fMaxEventTime,
+      "Abort events that take longer than this wall time (0 = no limit)");
+}
+
+EventWatchdog::~EventWatchdog() { delete fMessenger; }
+
+void EventWatchdog::BeginEvent() {
+  fEventFlags = 0;
+  fStepsSinceClock = 0;
+  fEventStart = std::chrono::steady_clock::now();
+}
+
+void EventWatchdog::Kill(G4Track *track, G4int flag) {
+  track->SetTrackStatus(fStopAndKill);
+  fEventFlags |= flag;
+  if (flag == kPhotonSteps)
+    fCounts.killedPhotons++;
+  else
+    fCounts.killedLateTracks++;
+}
+
+void EventWatchdog::CheckStep(const G4Step *step) {
+  G4Track *track = step->GetTrack();
+  if (fMaxPhotonSteps > 0 && track->GetCurrentStepNumber() > fMaxPhotonSteps &&
+      track->GetDefinition() == G4OpticalPhoton::OpticalPhotonDefinition()) {
+    Kill(track, kPhotonSteps);
+    return;
+  }
+  if (fMaxGlobalTime > 0. && track->GetGlobalTime() > fMaxGlobalTime) {
+    Kill(track, kGlobalTime);
+    return;
+  }
+
+  if (fMaxEventTime > 0. && !(fEventFlags & kWallClock) &&
+      ++fStepsSinceClock >= kClockInterval) {
+    fStepsSinceClock = 0;
+    if (SecondsSince(fEventStart) * s > fMaxEventTime) {
+      fEventFlags |= kWallClock;
+      // 清空栈并结束本事件，EndOfEventAction 照常调用
+      G4RunManager::GetRunManager()->AbortEvent();
+    }
+  }
+}
+
+void EventWatchdog::EndEvent() {
+  fCounts.events++;
+  for (G4int bit = 0; bit < 3; bit++)
+    if (fEventFlags & (1 << bit))
+      fCounts.flaggedEvents[bit]++;
+  fCounts.maxEventSeconds =
+      std::max(fCounts.maxEventSeconds, SecondsSince(fEventStart));
+}
+
+void EventWatchdog::Merge() {
+  G4AutoLock lock(&mergeMutex);
+  Counts &merged = MergedCounts();
+  merged.events += fCounts.events;
+  for (G4int bit = 0; bit < 3; bit++)
+    merged.flaggedEvents[bit] += fCounts.flaggedEvents[bit];
+  merged.killedPhotons += fCounts.killedPhotons;
+  merged.killedLateTracks += fCounts.killedLateTracks;
+  merged.maxEventSeconds =
+      std::max(merged.maxEventSeconds, fCounts.maxEventSeconds);
+  fCounts = Counts();
+}
+
+void EventWatchdog::PrintMerged() {
+  G4AutoLock lock(&mergeMutex);
+  Counts &merged = MergedCounts();
+  if (merged.events == 0)
+    return;
+
+  static const char *names[3] = {"maxPhotonSteps", "maxGlobalTime",
+                                 "maxEventTime"};
+  G4cout << "--- Event watchdog (" << merged.events << " events) ---"
+         << G4endl;
+  G4cout << "  Slowest event: " << merged.maxEventSeconds << " s" << G4endl;
+  for (G4int bit = 0; bit < 3; bit++) {
+    if (merged.flaggedEvents[bit] == 0)
+      continue;
+    G4cout << "  " << names[bit] << ": " << merged.flaggedEvents[bit]
+           << " events ("
+           << 100. * merged.flaggedEvents[bit] / merged.events << " %)";
+    if (bit == 0)
+      G4cout << ", " << merged.killedPhotons << " photons killed";
+    if (bit == 1)
+      G4cout << ", " << merged.killedLateTracks << " tracks killed";
+    if (bit == 2)
+      G4cout << " aborted";
+    G4cout << G4endl;
+  }
+  merged = Counts();
+}
@@ -0,0 +1,112 @@
+// MemoryMonitor.cc
+#include "MemoryMonitor.hh"
+#include "G4AutoLock.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <unistd.h>
+
+namespace {
+MemoryMonitor::HighWater &MergedHighWater() {
+  static MemoryMonitor::HighWater highWater;
+  return highWater;
+}
+
+G4Mutex mergeMutex = G4MUTEX_INITIALIZER;
+
+// 当前进程的常驻内存 (kB)，读取失败返回 0
+G4long CurrentRSSKB() {
+  std::ifstream statm("/proc/self/statm");
+  long pages = 0, resident = 0;
+  if (!(statm >> pages >> resident))
+    return 0;
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+} // namespace
+
+MemoryMonitor::MemoryMonitor()
+    : fMessenger(nullptr), fBounded(false), fMaxTrajectories(10000),
+      fMaxHitEntries(400), fBasketSize(32000), fEventTrajectories(0),
+      fEventStack(0) {
+  fMessenger = new G4GenericMessenger(this, "/CsI/memory/",
+                                      "Per-event memory limits");
+  fMessenger->DeclareProperty(
+      "bounded", fBounded,
+      "Cap trajectories and ntuple hit rows per event, small ntuple baskets");
+  fMessenger->DeclareProperty("maxTrajectories", fMaxTrajectories,
+                              "Trajectories kept per event in bounded mode");
+  fMessenger->DeclareProperty("maxHitEntries", fMaxHitEntries,
+                              "Hit rows written per event in bounded mode");
+  fMessenger->DeclareProperty("basketSize", fBasketSize,
+                              "Ntuple basket size in bytes in bounded mode");
+}
+
+MemoryMonitor::~MemoryMonitor() { delete fMessenger; }
+
+void MemoryMonitor::BeginEvent() {
+  fEventTrajectories = 0;
+  fEventStack = 0;
+}
+
+G4bool MemoryMonitor::AcceptTrajectory() {
+  if (fBounded && fMaxTrajectories > 0 &&
+      fEventTrajectories >= fMaxTrajectories) {
+    fHighWater.droppedTrajectories++;
+    return false;
+  }
+  fEventTrajectories++;
+  return true;
+}
+
+void MemoryMonitor::EndEvent(G4int nHits, G4long ntupleBytes,
+                             G4bool truncated) {
+  fHighWater.events++;
+  if (truncated)
+    fHighWater.truncatedEvents++;
+  fHighWater.hits = std::max(fHighWater.hits, nHits);
+  fHighWater.trajectories =
+      std::max(fHighWater.trajectories, fEventTrajectories);
+  fHighWater.stackTracks = std::max(fHighWater.stackTracks, fEventStack);
+  fHighWater.ntupleBytes = std::max(fHighWater.ntupleBytes, ntupleBytes);
+  fHighWater.rssKB = std::max(fHighWater.rssKB, CurrentRSSKB());
+}
+
+void MemoryMonitor::Merge() {
+  G4AutoLock lock(&mergeMutex);
+  HighWater &merged = MergedHighWater();
+  merged.events += fHighWater.events;
+  merged.truncatedEvents += fHighWater.truncatedEvents;
+  merged.droppedTrajectories += fHighWater.droppedTrajectories;
+  merged.hits = std::max(merged.hits, fHighWater.hits);
+  merged.trajectories = std::max(merged.trajectories, fHighWater.trajectories);
+  merged.stackTracks = std::max(merged.stackTracks, fHighWater.stackTracks);
+  merged.ntupleBytes = std::max(merged.ntupleBytes, fHighWater.ntupleBytes);
+  // 线程共享同一进程，RSS 取最大即可
+  merged.rssKB = std::max(merged.rssKB, fHighWater.rssKB);
+  fHighWater = HighWater();
+}
+
+void MemoryMonitor::PrintMerged() {
+  G4AutoLock lock(&mergeMutex);
+  HighWater &merged = MergedHighWater();
+  if (merged.events == 0)
+    return;
+
+  G4cout << "--- Per-event memory high-water (" << merged.events
+         << " events) ---" << G4endl;
+  G4cout << "  Hits:               " << merged.hits << G4endl;
+  G4cout << "  Trajectories:       " << merged.trajectories << G4endl;
+  G4cout << "  Stacked tracks:     " << merged.stackTracks << G4endl;
+  G4cout << "  Ntuple row vectors: " << merged.ntupleBytes / 1024. << " kB"
+         << G4endl;
+  G4cout << "  Process RSS:        " << merged.rssKB / 1024. << " MB"
+         << G4endl;
+  if (merged.truncatedEvents > 0 || merged.droppedTrajectories > 0) {
+    G4cout << "  Bounded mode: " << merged.truncatedEvents
+           << " events with truncated hit rows, "
+           << merged.droppedTrajectories << " trajectories not stored"
+           << G4endl;
+  }
+  merged = HighWater();
+}
@@ -0,0 +1,133 @@
+// OutputWriter.cc
+#include "OutputWriter.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+OutputWriter::OutputWriter(G4int depth, EventRecord *bound,
+                           HistogramFiller fillHistograms)
+    : fDepth(std::max(depth, 2)), fBound(bound),
+      fFillHistograms(std::move(fillHistograms)), fAnalysisManager(nullptr),
+      fPending(fDepth), fFree(fDepth), fStop(false), fBytes(bound->Bytes()),
+      fHeld(nullptr), fHeldBytes(0), fRows(0), fStalls(0), fStallSeconds(0.),
+      fMaxDepth(0), fDepthSum(0.) {
+  for (G4int i = 0; i < fDepth; i++) {
+    fRecords.emplace_back(new EventRecord());
+    fFree.Push(fRecords.back().get());
+    fBytes += fRecords.back()->Bytes();
+  }
+}
+
+OutputWriter::~OutputWriter() { Stop(); }
+
+void OutputWriter::Start() {
+  if (fThread.joinable())
+    return;
+  fAnalysisManager = G4AnalysisManager::Instance();
+  fStop.store(false);
+  fRows = 0;
+  fStalls = 0;
+  fStallSeconds = 0.;
+  fMaxDepth = 0;
+  fDepthSum = 0.;
+  fThread = std::thread(&OutputWriter::Run, this);
+}
+
+void OutputWriter::Stop() {
+  if (!fThread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop.store(true, std::memory_order_release);
+  }
+  fPendingReady.notify_one();
+  fThread.join();
+
+  G4cout << "[OutputWriter] " << fRows << " rows, queue depth max "
+         << fMaxDepth << "/" << fDepth << ", mean "
+         << (fRows > 0 ? fDepthSum / fRows : 0.) << "; " << fStalls
+         << " waits for a free row (" << fStallSeconds << " s)" << G4endl;
+}
+
+EventRecord *OutputWriter::Acquire() {
+  EventRecord *record = nullptr;
+  if (fFree.Pop(record)) {
+    fHeld = record;
+    fHeldBytes = record->Bytes();
+    return record;
+  }
+
+  // 所有行都在排队：等写线程腾出一行
+  auto t0 = std::chrono::steady_clock::now();
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fFreeReady.wait(lock, [&] { return fFree.Pop(record); });
+  }
+  fStalls++;
+  fStallSeconds += std::chrono::duration<G4double>(
+                       std::chrono::steady_clock::now() - t0)
+                       .count();
+  fHeld = record;
+  fHeldBytes = record->Bytes();
+  return record;
+}
+
+void OutputWriter::Push(EventRecord *record) {
+  fBytes += record->Bytes() - fHeldBytes;
+  fHeld = nullptr;
+  // 行的总数不超过队列容量，不会失败
+  fPending.Push(record);
+  // 写线程可能在检查队列和开始等待之间：经过锁再通知
+  { std::lock_guard<std::mutex> lock(fMutex); }
+  fPendingReady.notify_one();
+  size_t depth = fPending.Size();
+  fMaxDepth = std::max(fMaxDepth, depth);
+  fDepthSum += depth;
+  fRows++;
+}
+
+G4long OutputWriter::Bytes() const {
+  return fBytes + (fHeld ? fHeld->Bytes() - fHeldBytes : 0);
+}
+
+void OutputWriter::Run() {
+  EventRecord *record = nullptr;
+  while (true) {
+    if (fPending.Pop(record)) {
+      Write(record);
+      continue;
+    }
+    // 先看 stop 再确认队列已空，保证 Stop() 之前放入的行都写出
+    if (fStop.load(std::memory_order_acquire)) {
+      while (fPending.Pop(record))
+        Write(record);
+      return;
+    }
+    std::unique_lock<std::mutex> lock(fMutex);
+    fPendingReady.wait(lock, [&] {
+      return fPending.Size() > 0 || fStop.load(std::memory_order_acquire);
+    });
+  }
+}
+
+void OutputWriter::Write(EventRecord *record) {
+  fBound->Swap(*record);
+  if (fFillHistograms)
+    fFillHistograms(fAnalysisManager, *fBound);
+  fAnalysisManager->FillNtupleIColumn(0, fBound->eventID);
+  fAnalysisManager->FillNtupleDColumn(1, fBound->totalEdep);
+  fAnalysisManager->FillNtupleIColumn(2, fBound->hitCount);
+  fAnalysisManager->FillNtupleDColumn(3, fBound->eventWeight);
+  fAnalysisManager->FillNtupleIColumn(4, fBound->watchdogFlags);
+  fAnalysisManager->FillNtupleIColumn(5, fBound->configIndex);
+  fAnalysisManager->FillNtupleIColumn(6, fBound->truncated);
+  // vector columns are bound to fBound by reference
+  fAnalysisManager->AddNtupleRow();
+
+  record->Clear();
+  fFree.Push(record);
+  { std::lock_guard<std::mutex> lock(fMutex); }
+  fFreeReady.notify_one();
+}
@@ -0,0 +1,179 @@
+// ParameterSweep.cc
+#include "ParameterSweep.hh"
+#include "G4RunManager.hh"
+#include "G4Threading.hh"
+#include "G4UIcommandTree.hh"
+#include "G4UImanager.hh"
+#include "G4ios.hh"
+#include "g4root.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+const char *kGeometryDirectory = "/CsI/detector/";
+
+G4String Trim(const std::string &text) {
+  size_t first = text.find_first_not_of(" \t");
+  if (first == std::string::npos)
+    return "";
+  size_t last = text.find_last_not_of(" \t");
+  return text.substr(first, last - first + 1);
+}
+
+// 配置编号 -> 各轴取值的下标（最后一个轴变化最快）
+std::vector<size_t> ValueIndices(G4int config,
+                                 const std::vector<size_t> &sizes) {
+  std::vector<size_t> indices(sizes.size());
+  for (size_t i = sizes.size(); i-- > 0;) {
+    indices[i] = config % sizes[i];
+    config /= sizes[i];
+  }
+  return indices;
+}
+} // namespace
+
+ParameterSweep::ParameterSweep(const G4String &outputName)
+    : fMessenger(nullptr), fOutputName(outputName), fRunning(false),
+      fConfigIndex(0), fConfigCount(0) {
+  fMessenger = new G4GenericMessenger(
+      this, "/CsI/sweep/", "Run a grid of configurations in one process");
+  fMessenger->DeclareMethod(
+      "add", &ParameterSweep::AddAxis,
+      "Sweep axis: a UI command and its comma-separated values, e.g. "
+      "/CsI/generator/particleEnergy 1 MeV, 4 MeV");
+  fMessenger->DeclareMethod("clear", &ParameterSweep::Clear,
+                            "Remove all sweep axes");
+  fMessenger->DeclareMethod(
+      "beamOn", &ParameterSweep::BeamOn,
+      "Run every combination of the axis values with this many events");
+}
+
+ParameterSweep::~ParameterSweep() { delete fMessenger; }
+
+void ParameterSweep::AddAxis(const G4String &commandAndValues) {
+  std::istringstream iss(commandAndValues);
+  Axis axis;
+  iss >> axis.command;
+  std::string value;
+  while (std::getline(iss, value, ',')) {
+    value = Trim(value);
+    if (!value.empty())
+      axis.values.push_back(value);
+  }
+  if (axis.command.empty() || axis.command[0] != '/' || axis.values.empty()) {
+    G4cerr << "[ParameterSweep] Usage: /CsI/sweep/add <command> <value>, "
+              "<value> ..."
+           << G4endl;
+    return;
+  }
+  axis.geometry = axis.command.compare(0, std::strlen(kGeometryDirectory),
+                                       kGeometryDirectory) == 0;
+  fAxes.push_back(axis);
+}
+
+void ParameterSweep::Clear() { fAxes.clear(); }
+
+void ParameterSweep::WriteConfigTable(const std::vector<Axis> &axes) const {
+  std::vector<size_t> sizes;
+  for (const auto &axis : axes)
+    sizes.push_back(axis.values.size());
+
+  G4String fileName = fOutputName + "_SweepConfigs.txt";
+  std::ofstream out(fileName);
+  out << "ConfigIndex";
+  for (const auto &axis : axes)
+    out << "\t" << axis.command;
+  out << "\n";
+  for (G4int config = 0; config < fConfigCount; config++) {
+    std::vector<size_t> indices = ValueIndices(config, sizes);
+    out << config;
+    for (size_t i = 0; i < axes.size(); i++)
+      out << "\t" << axes[i].values[indices[i]];
+    out << "\n";
+  }
+  G4cout << "[ParameterSweep] Configurations saved to '" << fileName << "'"
+         << G4endl;
+}
+
+void ParameterSweep::BeamOn(G4int nEvents) {
+  if (fAxes.empty()) {
+    G4cerr << "[ParameterSweep] No sweep axes, use /CsI/sweep/add first"
+           << G4endl;
+    return;
+  }
+  if (G4Threading::IsMultithreadedApplication()) {
+    G4cerr << "[ParameterSweep] Sweeps need the sequential run manager"
+           << G4endl;
+    return;
+  }
+  auto UImanager = G4UImanager::GetUIpointer();
+  for (const auto &axis : fAxes) {
+    if (!UImanager->GetTree()->FindPath(axis.command)) {
+      G4cerr << "[ParameterSweep] Unknown command " << axis.command << G4endl;
+      return;
+    }
+  }
+
+  // 几何轴在最外层：几何的重建次数只取决于几何取值的组合数
+  std::vector<Axis> axes(fAxes);
+  std::stable_partition(axes.begin(), axes.end(),
+                        [](const Axis &axis) { return axis.geometry; });
+  std::vector<size_t> sizes;
+  fConfigCount = 1;
+  for (const auto &axis : axes) {
+    sizes.push_back(axis.values.size());
+    fConfigCount *= axis.values.size();
+  }
+  WriteConfigTable(axes);
+  G4cout << "[ParameterSweep] " << fConfigCount << " configurations x "
+         << nEvents << " events" << G4endl;
+
+  auto runManager = G4RunManager::GetRunManager();
+  std::vector<size_t> previous;
+  G4int nRebuilds = 0;
+  for (G4int config = 0; config < fConfigCount; config++) {
+    std::vector<size_t> indices = ValueIndices(config, sizes);
+    G4bool geometryChanged = false;
+    for (size_t i = 0; i < axes.size(); i++) {
+      if (config > 0 && indices[i] == previous[i])
+        continue;
+      const G4String &value = axes[i].values[indices[i]];
+      // 第一个配置：几何参数与当前（已构建的）值相同就不必重建
+      if (axes[i].geometry &&
+          UImanager->GetCurrentValues(axes[i].command) != value)
+        geometryChanged = true;
+      if (UImanager->ApplyCommand(axes[i].command + " " + value) != 0) {
+        G4cerr << "[ParameterSweep] '" << axes[i].command << " " << value
+               << "' failed, sweep stopped after " << config
+               << " configurations" << G4endl;
+        // 上一个配置结束时输出文件还开着
+        if (fRunning) {
+          auto analysisManager = G4AnalysisManager::Instance();
+          analysisManager->Write();
+          analysisManager->CloseFile();
+        }
+        fRunning = false;
+        return;
+      }
+    }
+    previous = indices;
+
+    if (geometryChanged) {
+      // 下一次 BeamOn 时重新调用 Construct()/ConstructSDandField()
+      runManager->ReinitializeGeometry();
+      nRebuilds++;
+    }
+    fRunning = true;
+    fConfigIndex = config;
+    G4cout << "[ParameterSweep] Configuration " << config + 1 << "/"
+           << fConfigCount << G4endl;
+    runManager->BeamOn(nEvents);
+  }
+  fRunning = false;
+  G4cout << "[ParameterSweep] Done: " << fConfigCount << " configurations, "
+         << nRebuilds << " geometry rebuilds, output in " << fOutputName
+         << ".root" << G4endl;
+}
@@ -1,19 +1,64 @@
 // PhysicsList.cc
 #include "PhysicsList.hh"
 #include "G4DecayPhysics.hh"
+#include "G4EmParameters.hh"
 #include "G4EmStandardPhysics_option4.hh"
+#include "G4FastSimulationPhysics.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4Material.hh"
 #include "G4OpticalPhysics.hh"
+#include "G4ProductionCuts.hh"
+#include "G4RegionStore.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Version.hh"
+
+#include <dirent.h>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+// 目录中的物理表写完后最后写入 stamp，读取前比对其内容
+const char *kStampName = "/physics_tables.stamp";
+
+// 删除目录及其中的文件（写表失败或另一个进程先写完时的临时目录）
+void RemoveDirectory(const G4String &dir) {
+  if (DIR *d = opendir(dir.c_str())) {
+    while (dirent *entry = readdir(d)) {
+      G4String name = entry->d_name;
+      if (name != "." && name != "..")
+        unlink((dir + "/" + name).c_str());
+    }
+    closedir(d);
+  }
+  rmdir(dir.c_str());
+}
+} // namespace
 
 PhysicsList::PhysicsList()
-    : G4VModularPhysicsList() // 从头构建，不继承FTFP_BERT
-{
+    : G4VModularPhysicsList(), // 从头构建，不继承FTFP_BERT
+      fOpticalEnabled(false), fFastShowerEnabled(false), fStoreTables(false),
+      fStartupDone(false),
+      fConstructionTime(std::chrono::steady_clock::now()) {
   fMessenger =
       new G4GenericMessenger(this, "/CsI/physics/", "Physics List Control");
   fMessenger->DeclareMethod("optical", &PhysicsList::SetOpticalPhysics,
                             "Enable Optical Physics");
+  fMessenger
+      ->DeclareMethod("fastShower", &PhysicsList::SetFastShowerPhysics,
+                      "Parametrise e-/e+ showers in the crystal array "
+                      "(GFlash, see /CsI/detector/fastShowerMinEnergy)")
+      .SetStates(G4State_PreInit);
   fMessenger->DeclareMethod("verbose", &PhysicsList::SetVerboseLevel,
                             "Set physics list verbose level");
+  fMessenger
+      ->DeclareMethod("tableDir", &PhysicsList::SetTableDirectory,
+                      "Store physics tables here on the first job and "
+                      "retrieve them in later jobs")
+      .SetStates(G4State_PreInit);
 
   SetVerboseLevel(1);
 
@@ -35,8 +80,119 @@ PhysicsList::~PhysicsList() { delete fMessenger; }
 
 void PhysicsList::SetOpticalPhysics(G4bool on) {
   G4cout << ">>> SetOpticalPhysics called with: " << on << '\n';
-  if (on) {
+  if (on && !fOpticalEnabled) {
     RegisterPhysics(new G4OpticalPhysics());
+    fOpticalEnabled = true;
     G4cout << ">>> Optical Physics Enabled!" << '\n';
   }
 }
+
+void PhysicsList::SetFastShowerPhysics(G4bool on) {
+  if (on && !fFastShowerEnabled) {
+    auto fastSimulation = new G4FastSimulationPhysics();
+    // GFlash 只参数化 e-/e+ 簇射；photon 在第一次相互作用后由 e-/e+ 接手
+    fastSimulation->ActivateFastSimulation("e-");
+    fastSimulation->ActivateFastSimulation("e+");
+    RegisterPhysics(fastSimulation);
+    fFastShowerEnabled = true;
+    G4cout << "[PhysicsList] Fast shower simulation enabled" << G4endl;
+  }
+}
+
+void PhysicsList::SetTableDirectory(const G4String &dir) { fTableDir = dir; }
+
+G4String PhysicsList::TableStamp() const {
+  // 物理表依赖 Geant4 版本、物理构造器、电磁参数，以及材料和各区域的
+  // 产生阈值（几何已在 SetCuts 之前构建）
+  std::ostringstream stamp;
+  stamp << G4Version << "\noptical " << fOpticalEnabled << "\nfastShower "
+        << fFastShowerEnabled << "\n"
+        << *G4EmParameters::Instance();
+  for (auto region : *G4RegionStore::GetInstance()) {
+    stamp << "region " << region->GetName();
+    if (auto cuts = region->GetProductionCuts()) {
+      for (const char *particle : {"gamma", "e-", "e+", "proton"})
+        stamp << " " << cuts->GetProductionCut(particle) / mm;
+    }
+    stamp << "\n";
+  }
+  std::set<G4String> materials;
+  for (auto volume : *G4LogicalVolumeStore::GetInstance()) {
+    if (auto material = volume->GetMaterial()) {
+      std::ostringstream entry;
+      entry << material->GetName() << " " << material->GetDensity() / (g / cm3);
+      materials.insert(entry.str());
+    }
+  }
+  for (const auto &material : materials)
+    stamp << "material " << material << "\n";
+  return stamp.str();
+}
+
+void PhysicsList::SetCuts() {
+  G4VModularPhysicsList::SetCuts();
+  if (fTableDir.empty())
+    return;
+
+  // 每种配置一个子目录（以 stamp 的散列命名）：不同配置的作业互不覆盖，
+  // 写好的目录不再改动，其他作业可以随时读取
+  G4String stamp = TableStamp();
+  std::ostringstream path;
+  path << fTableDir << "/" << std::hex << std::hash<std::string>()(stamp);
+  fTablePath = path.str();
+
+  std::ifstream in(fTablePath + kStampName);
+  std::stringstream stored;
+  stored << in.rdbuf();
+  if (in && stored.str() == stamp) {
+    SetPhysicsTableRetrieved(fTablePath);
+    G4cout << "[PhysicsList] Retrieving physics tables from " << fTablePath
+           << G4endl;
+    return;
+  }
+  if (in) {
+    // 散列冲突：保留已有的表，本作业只计算
+    G4cout << "[PhysicsList] Physics tables in " << fTablePath
+           << " belong to another configuration, tables will not be stored"
+           << G4endl;
+    return;
+  }
+  mkdir(fTableDir.c_str(), 0755);
+  fStoreTables = true;
+}
+
+void PhysicsList::EndOfStartup() {
+  if (fStartupDone)
+    return;
+  fStartupDone = true;
+
+  if (fStoreTables) {
+    // 写到本进程的临时目录，完整后整体改名；多个作业同时写时先改名的
+    // 生效，其余的删掉自己的临时目录。中途退出只留下一个无人读取的
+    // 临时目录，不会阻止以后的作业缓存
+    std::ostringstream tmpPath;
+    tmpPath << fTablePath << ".tmp" << getpid();
+    G4String tmpDir = tmpPath.str();
+    mkdir(tmpDir.c_str(), 0755);
+    if (StorePhysicsTable(tmpDir)) {
+      std::ofstream(tmpDir + kStampName) << TableStamp();
+      if (rename(tmpDir.c_str(), fTablePath.c_str()) == 0)
+        G4cout << "[PhysicsList] Physics tables stored in " << fTablePath
+               << G4endl;
+      else
+        RemoveDirectory(tmpDir); // 另一个作业已经写好
+    } else {
+      G4cerr << "[PhysicsList] Failed to store physics tables in "
+             << fTablePath << G4endl;
+      RemoveDirectory(tmpDir);
+    }
+  }
+
+  // 从构造物理列表到第一次 run 开始（含 /run/initialize 和建表/读表）
+  G4double seconds = std::chrono::duration<G4double>(
+                         std::chrono::steady_clock::now() - fConstructionTime)
+                         .count();
+  G4cout << "[PhysicsList] Startup took " << seconds << " s (physics tables "
+         << (IsPhysicsTableRetrieved() ? "retrieved" : "built") << ")"
+         << G4endl;
+}
@@ -1,46 +1,82 @@
 // PrimaryGeneratorAction.cc
 #include "PrimaryGeneratorAction.hh"
 #include "G4GenericMessenger.hh"
-#include "G4ParticleGun.hh"
-#include "G4RandomDirection.hh"
 #include "G4SystemOfUnits.hh"
+#include "PrimaryGenerators.hh"
 #include "Randomize.hh"
+#include "RunAction.hh"
 #include <G4Event.hh>
-#include <G4ParticleDefinition.hh>
-#include <G4ParticleTable.hh>
+#include <G4PrimaryVertex.hh>
+#include <G4RunManager.hh>
 
+#include <algorithm>
 #include <ctime>
+#include <sstream>
 #include <unistd.h>
 
-#include "G4ParticleDefinition.hh"
-#include "G4ParticleTable.hh"
-
 PrimaryGeneratorAction::PrimaryGeneratorAction()
-    : G4VUserPrimaryGeneratorAction(), fParticleGun(nullptr),
-      fMessenger(nullptr), fRandMessenger(nullptr), fMaxEnergy(4 * MeV),
-      fMode("ePair"), fDeflectAngle(1.0), fParticleEnergy(4.0 * MeV),
-      fAutoSeed(true), fSeed(0), fElectron(nullptr), fPositron(nullptr), fNx(8),
-      fNy(8), fNz(5), fCrystalSize(10 * cm), fGap(0.1 * cm) {
-
-  fParticleGun = new G4ParticleGun(1);
+    : G4VUserPrimaryGeneratorAction(), fMessenger(nullptr),
+      fRandMessenger(nullptr), fBiasMessenger(nullptr), fMaxEnergy(4 * MeV),
+      fMode("ePair"), fDeflectAngle(1.0 * deg), fParticleEnergy(4.0 * MeV),
+      fAxionMass(1.0 * MeV), fFirstEntry(0), fAutoSeed(true), fSeed(0),
+      fGenerator(nullptr), fGammaLines(nullptr), fVertexFile(nullptr),
+      fMappedVertices(nullptr), fNx(8), fNy(8), fNz(5),
+      fCrystalSize(10 * cm), fGap(0.1 * cm) {
 
-  // Cache particle definitions
-  G4ParticleTable *particleTable = G4ParticleTable::GetParticleTable();
-  fElectron = particleTable->FindParticle("e-");
-  fPositron = particleTable->FindParticle("e+");
+  // 生成器对象，模式名（含旧的别名）映射到同一个对象
+  auto pair = new PairGenerator(fMaxEnergy, fSampler);
+  auto deflected =
+      new DeflectedPairGenerator(fMaxEnergy, fDeflectAngle, fSampler);
+  fGammaLines = new GammaLineGenerator(fParticleEnergy);
+  auto axion = new AxionDecayGenerator(fAxionMass, fParticleEnergy);
+  fVertexFile = new VertexFileGenerator();
+  fMappedVertices = new MappedVertexGenerator(fFirstEntry);
+  RegisterMode("ePair", pair);
+  RegisterMode("ePairOpposite", pair);
+  RegisterMode("twoGammaOpposite", pair);
+  RegisterMode("ePairDeflected", deflected);
+  RegisterMode("twoGammaDeflected", deflected);
+  RegisterMode("gammaLine", fGammaLines);
+  RegisterMode("axionDecay", axion);
+  RegisterMode("vertexFile", fVertexFile);
+  RegisterMode("vertexBinary", fMappedVertices);
+  fGenerator = pair;
 
   // Define commands
   fMessenger = new G4GenericMessenger(this, "/CsI/generator/",
                                       "Primary generator control");
-  fMessenger->DeclarePropertyWithUnit("maxEnergy", "MeV", fMaxEnergy,
-                                      "Maximum energy for electrons");
-  fMessenger->DeclareProperty(
-      "mode", fMode, "Generator mode: ePair, ePairOpposite, ePairDeflected");
+  fMessenger->DeclareMethodWithUnit("maxEnergy", "MeV",
+                                    &PrimaryGeneratorAction::SetMaxEnergy,
+                                    "Maximum energy for electrons");
+  fMessenger->DeclareMethod(
+      "mode", &PrimaryGeneratorAction::SetMode,
+      "Generator mode: ePair, ePairOpposite, ePairDeflected, gammaLine, "
+      "axionDecay, vertexFile, vertexBinary");
   fMessenger->DeclarePropertyWithUnit(
       "deflectAngle", "deg", fDeflectAngle,
       "Deflection angle (deg) for ePairDeflected");
-  fMessenger->DeclarePropertyWithUnit("particleEnergy", "MeV", fParticleEnergy,
-                                      "Energy for generated particles (e-/e+)");
+  fMessenger->DeclareMethodWithUnit(
+      "particleEnergy", "MeV", &PrimaryGeneratorAction::SetParticleEnergy,
+      "Default gammaLine energy and total energy of the axionDecay parent "
+      "(> 0, >= axionMass in axionDecay mode)");
+  fMessenger->DeclareMethodWithUnit("axionMass", "MeV",
+                                    &PrimaryGeneratorAction::SetAxionMass,
+                                    "Mass of the axion-like particle (> 0, "
+                                    "<= particleEnergy in axionDecay mode)");
+  fMessenger->DeclareMethod(
+      "addGammaLine", &PrimaryGeneratorAction::AddGammaLine,
+      "Add a gamma line for gammaLine mode: energy(MeV) [intensity]");
+  fMessenger->DeclareMethod("clearGammaLines",
+                            &PrimaryGeneratorAction::ClearGammaLines,
+                            "Remove all gamma lines");
+  fMessenger->DeclareMethod("vertexFile",
+                            &PrimaryGeneratorAction::LoadVertexFile,
+                            "Load a vertex list and switch to vertexFile mode");
+  fMessenger->DeclareMethod(
+      "vertexBinary", &PrimaryGeneratorAction::MapVertexFile,
+      "Memory-map a binary vertex file and switch to vertexBinary mode");
+  fMessenger->DeclareProperty("firstEntry", fFirstEntry,
+                              "vertexBinary entry read by event 0");
 
   // Random seed messenger under /CsI/random/
   fRandMessenger =
@@ -53,6 +89,20 @@ PrimaryGeneratorAction::PrimaryGeneratorAction()
                                 &PrimaryGeneratorAction::ApplyRandomSeed,
                                 "Apply the random seed now");
 
+  // Importance sampling under /CsI/bias/
+  fBiasMessenger = new G4GenericMessenger(this, "/CsI/bias/",
+                                          "Importance sampling control");
+  fBiasMessenger->DeclareMethod(
+      "energyPDF", &PrimaryGeneratorAction::LoadEnergyPDF,
+      "Biased energy PDF file (low high density, MeV), truncated to "
+      "[0, maxEnergy] (again whenever maxEnergy changes); must cover it");
+  fBiasMessenger->DeclareMethod(
+      "boundaryPDF", &PrimaryGeneratorAction::LoadBoundaryPDF,
+      "Biased PDF of the vertex distance to the nearest crystal face "
+      "(low high density, mm)");
+  fBiasMessenger->DeclareMethod("clear", &PrimaryGeneratorAction::ClearBias,
+                                "Back to unbiased sampling (weight 1)");
+
   // 计算阵列总尺寸和起点位置
   fTotalX = fNx * fCrystalSize + (fNx - 1) * fGap;
   fTotalY = fNy * fCrystalSize + (fNy - 1) * fGap;
@@ -67,13 +117,112 @@ PrimaryGeneratorAction::PrimaryGeneratorAction()
 }
 
 PrimaryGeneratorAction::~PrimaryGeneratorAction() {
-  delete fParticleGun;
   delete fMessenger;
+  delete fRandMessenger;
+  delete fBiasMessenger;
+  for (auto generator : fGenerators)
+    delete generator;
 }
 
-void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event) {
-  // static G4int pairCount = 0;
+void PrimaryGeneratorAction::RegisterMode(const G4String &name,
+                                          VPrimaryGenerator *generator) {
+  if (std::find(fGenerators.begin(), fGenerators.end(), generator) ==
+      fGenerators.end())
+    fGenerators.push_back(generator);
+  fModes[name] = generator;
+}
+
+void PrimaryGeneratorAction::SetMode(const G4String &mode) {
+  auto it = fModes.find(mode);
+  if (it == fModes.end()) {
+    G4cerr << "[PrimaryGeneratorAction] Unknown generator mode: " << mode
+           << ", keeping " << fMode << G4endl;
+    return;
+  }
+  if (mode == "axionDecay" && fParticleEnergy < fAxionMass) {
+    G4cerr << "[PrimaryGeneratorAction] axionDecay needs particleEnergy >= "
+              "axionMass, got "
+           << fParticleEnergy / MeV << " MeV < " << fAxionMass / MeV
+           << " MeV, keeping " << fMode << G4endl;
+    return;
+  }
+  fMode = mode;
+  fGenerator = it->second;
+}
+
+void PrimaryGeneratorAction::SetParticleEnergy(G4double energy) {
+  // axionDecay 模式下总能量不能小于静质量：先改 particleEnergy 再改 axionMass
+  if (energy <= 0. || (fMode == "axionDecay" && energy < fAxionMass)) {
+    G4cerr << "[PrimaryGeneratorAction] particleEnergy " << energy / MeV
+           << " MeV rejected (must be > 0 and >= axionMass "
+           << fAxionMass / MeV << " MeV in axionDecay mode), keeping "
+           << fParticleEnergy / MeV << " MeV" << G4endl;
+    return;
+  }
+  fParticleEnergy = energy;
+}
+
+void PrimaryGeneratorAction::SetAxionMass(G4double mass) {
+  if (mass <= 0. || (fMode == "axionDecay" && mass > fParticleEnergy)) {
+    G4cerr << "[PrimaryGeneratorAction] axionMass " << mass / MeV
+           << " MeV rejected (must be > 0 and <= particleEnergy "
+           << fParticleEnergy / MeV << " MeV in axionDecay mode), keeping "
+           << fAxionMass / MeV << " MeV" << G4endl;
+    return;
+  }
+  fAxionMass = mass;
+}
+
+void PrimaryGeneratorAction::AddGammaLine(const G4String &energyAndIntensity) {
+  std::istringstream iss(energyAndIntensity);
+  G4double energy = 0., intensity = 1.;
+  iss >> energy >> intensity;
+  fGammaLines->AddLine(energy * MeV, intensity);
+}
+
+void PrimaryGeneratorAction::ClearGammaLines() { fGammaLines->ClearLines(); }
+
+void PrimaryGeneratorAction::LoadVertexFile(const G4String &fileName) {
+  if (fVertexFile->Load(fileName) > 0)
+    SetMode("vertexFile");
+}
+
+void PrimaryGeneratorAction::MapVertexFile(const G4String &fileName) {
+  if (fMappedVertices->Open(fileName) > 0)
+    SetMode("vertexBinary");
+}
+
+void PrimaryGeneratorAction::SetMaxEnergy(G4double maxEnergy) {
+  // 已加载的能量 PDF 按新的上限重新截断和归一化。PDF 不覆盖新的
+  // [0, maxEnergy] 时拒绝：超出支撑的能量 q = 0，永远抽不到
+  if (!fEnergyPDFFile.empty() &&
+      fSampler.LoadEnergyPDF(fEnergyPDFFile, maxEnergy) == 0) {
+    G4cerr << "[PrimaryGeneratorAction] maxEnergy " << maxEnergy / MeV
+           << " MeV rejected, still " << fMaxEnergy / MeV
+           << " MeV; load a covering energy PDF or /CsI/bias/clear first"
+           << G4endl;
+    return;
+  }
+  fMaxEnergy = maxEnergy;
+}
+
+void PrimaryGeneratorAction::LoadEnergyPDF(const G4String &fileName) {
+  // 读取失败或不覆盖 [0, maxEnergy] 时保留原来的 PDF
+  if (fSampler.LoadEnergyPDF(fileName, fMaxEnergy) > 0)
+    fEnergyPDFFile = fileName;
+}
 
+void PrimaryGeneratorAction::LoadBoundaryPDF(const G4String &fileName) {
+  fSampler.LoadBoundaryPDF(fileName, fCrystalSize);
+}
+
+void PrimaryGeneratorAction::ClearBias() {
+  fSampler.ClearEnergyPDF();
+  fSampler.ClearBoundaryPDF();
+  fEnergyPDFFile = "";
+}
+
+G4ThreeVector PrimaryGeneratorAction::SampleVertex(G4double &weight) const {
   // 随机选择一个晶体
   G4int ix = G4UniformRand() * fNx;
   if (ix >= fNx)
@@ -90,84 +239,31 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event) {
   G4double centerY = fStartY + iy * (fCrystalSize + fGap);
   G4double centerZ = fStartZ + iz * (fCrystalSize + fGap);
 
-  // 晶体内均匀撒点，坐标偏移[-crystalSize/2, crystalSize/2]
-  G4double localX = (G4UniformRand() - 0.5) * fCrystalSize;
-  G4double localY = (G4UniformRand() - 0.5) * fCrystalSize;
-  G4double localZ = (G4UniformRand() - 0.5) * fCrystalSize;
-
-  G4ThreeVector vertexPos(centerX + localX, centerY + localY, centerZ + localZ);
-
-  // 动能在0到8 MeV之间均匀分布
-  G4double energyMeV = G4UniformRand() * fMaxEnergy;
-
-  // two-particle modes will use cached fElectron/fPositron
-
-  // Mode handling
-  if (fMode == "ePairOpposite" || fMode == "twoGammaOpposite") {
-    // generate e- and e+ in opposite directions
-    G4ThreeVector dir = G4RandomDirection();
+  // 晶体内的位置（均匀或按边界距离偏置）
+  return G4ThreeVector(centerX, centerY, centerZ) +
+         fSampler.SampleLocalPosition(fCrystalSize, weight);
+}
 
-    // electron
-    fParticleGun->SetParticleDefinition(fElectron);
-    fParticleGun->SetParticleEnergy(energyMeV);
-    fParticleGun->SetParticlePosition(vertexPos);
-    fParticleGun->SetParticleMomentumDirection(dir);
-    fParticleGun->GeneratePrimaryVertex(event);
+void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event) {
+  // 从检查点续跑时 EventID 接着上次编号（生成器和输出都用它）
+  auto runAction = static_cast<const RunAction *>(
+      G4RunManager::GetRunManager()->GetUserRunAction());
+  if (runAction && runAction->GetEventOffset() > 0)
+    event->SetEventID(event->GetEventID() + runAction->GetEventOffset());
 
-    // positron opposite
-    fParticleGun->SetParticleDefinition(fPositron);
-    fParticleGun->SetParticleEnergy(energyMeV);
-    fParticleGun->SetParticlePosition(vertexPos);
-    fParticleGun->SetParticleMomentumDirection(-dir);
-    fParticleGun->GeneratePrimaryVertex(event);
-    return;
-  }
+  G4ThreeVector vertexPos;
+  G4double weight = 1.;
+  if (fGenerator->UsesSampledVertex())
+    vertexPos = SampleVertex(weight);
+  fGenerator->Generate(event, vertexPos);
 
-  if (fMode == "ePairDeflected" || fMode == "twoGammaDeflected") {
-    G4ThreeVector w = G4RandomDirection();
-    G4ThreeVector refZ(0., 0., 1.);
-    G4ThreeVector refX(1., 0., 0.);
-    G4ThreeVector u = w.cross(refZ);
-    if (u.mag() < 1e-6) {
-      u = w.cross(refX);
+  // 位置偏置的权重乘到生成器给出的顶点权重上
+  if (weight != 1.) {
+    for (G4int i = 0; i < event->GetNumberOfPrimaryVertex(); i++) {
+      G4PrimaryVertex *vertex = event->GetPrimaryVertex(i);
+      vertex->SetWeight(vertex->GetWeight() * weight);
     }
-    u = u.unit();
-
-    G4double theta = fDeflectAngle * deg;
-    G4ThreeVector v1 = std::cos(theta) * w + std::sin(theta) * u;
-    G4ThreeVector v2 = std::cos(theta) * w - std::sin(theta) * u;
-
-    fParticleGun->SetParticleDefinition(fElectron);
-    fParticleGun->SetParticleEnergy(energyMeV);
-    fParticleGun->SetParticlePosition(vertexPos);
-    fParticleGun->SetParticleMomentumDirection(v1.unit());
-    fParticleGun->GeneratePrimaryVertex(event);
-
-    fParticleGun->SetParticlePosition(vertexPos);
-    fParticleGun->SetParticleDefinition(fPositron);
-    fParticleGun->SetParticleEnergy(energyMeV);
-    fParticleGun->SetParticleMomentumDirection(v2.unit());
-    fParticleGun->GeneratePrimaryVertex(event);
-    return;
   }
-
-  // 生成一对电子对，方向共线反向（假设沿随机单位矢量n和-n）
-  G4ThreeVector dir1 = G4RandomDirection();
-  G4ThreeVector dir2 = -dir1;
-
-  // --- 产生电子 ---
-  fParticleGun->SetParticleDefinition(fElectron);
-  fParticleGun->SetParticleEnergy(energyMeV);
-  fParticleGun->SetParticlePosition(vertexPos);
-  fParticleGun->SetParticleMomentumDirection(dir1);
-  fParticleGun->GeneratePrimaryVertex(event);
-
-  // --- 产生正电子 ---
-  fParticleGun->SetParticleDefinition(fPositron);
-  fParticleGun->SetParticleEnergy(energyMeV);
-  fParticleGun->SetParticlePosition(vertexPos);
-  fParticleGun->SetParticleMomentumDirection(dir2);
-  fParticleGun->GeneratePrimaryVertex(event);
 }
 
 void PrimaryGeneratorAction::ApplyRandomSeed() {
@@ -0,0 +1,349 @@
+// PrimaryGenerators.cc
+#include "PrimaryGenerators.hh"
+#include "BiasedSampler.hh"
+#include "G4Event.hh"
+#include "G4LorentzVector.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ParticleTable.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4RandomDirection.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void VPrimaryGenerator::AddParticle(G4PrimaryVertex *vertex,
+                                    G4ParticleDefinition *particle,
+                                    G4double energy,
+                                    const G4ThreeVector &direction) {
+  auto primary = new G4PrimaryParticle(particle);
+  primary->SetKineticEnergy(energy);
+  primary->SetMomentumDirection(direction);
+  vertex->SetPrimary(primary);
+}
+
+// ---------------------------------------------------------------------------
+
+PairGenerator::PairGenerator(const G4double &maxEnergy,
+                             const BiasedSampler &sampler)
+    : fMaxEnergy(maxEnergy), fSampler(sampler) {
+  G4ParticleTable *particleTable = G4ParticleTable::GetParticleTable();
+  fElectron = particleTable->FindParticle("e-");
+  fPositron = particleTable->FindParticle("e+");
+}
+
+void PairGenerator::Generate(G4Event *event, const G4ThreeVector &vertexPos) {
+  G4double weight = 1.;
+  G4double energy = fSampler.SampleEnergy(fMaxEnergy, weight);
+  G4ThreeVector dir = G4RandomDirection();
+
+  auto vertex = new G4PrimaryVertex(vertexPos, 0.);
+  vertex->SetWeight(weight);
+  AddParticle(vertex, fElectron, energy, dir);
+  AddParticle(vertex, fPositron, energy, -dir);
+  event->AddPrimaryVertex(vertex);
+}
+
+// ---------------------------------------------------------------------------
+
+DeflectedPairGenerator::DeflectedPairGenerator(const G4double &maxEnergy,
+                                               const G4double &deflectAngle,
+                                               const BiasedSampler &sampler)
+    : fMaxEnergy(maxEnergy), fSampler(sampler), fDeflectAngle(deflectAngle) {
+  G4ParticleTable *particleTable = G4ParticleTable::GetParticleTable();
+  fElectron = particleTable->FindParticle("e-");
+  fPositron = particleTable->FindParticle("e+");
+}
+
+void DeflectedPairGenerator::Generate(G4Event *event,
+                                      const G4ThreeVector &vertexPos) {
+  G4double weight = 1.;
+  G4double energy = fSampler.SampleEnergy(fMaxEnergy, weight);
+
+  G4ThreeVector w = G4RandomDirection();
+  G4ThreeVector u = w.cross(G4ThreeVector(0., 0., 1.));
+  if (u.mag() < 1e-6) {
+    u = w.cross(G4ThreeVector(1., 0., 0.));
+  }
+  u = u.unit();
+
+  G4ThreeVector v1 = std::cos(fDeflectAngle) * w + std::sin(fDeflectAngle) * u;
+  G4ThreeVector v2 = std::cos(fDeflectAngle) * w - std::sin(fDeflectAngle) * u;
+
+  auto vertex = new G4PrimaryVertex(vertexPos, 0.);
+  vertex->SetWeight(weight);
+  AddParticle(vertex, fElectron, energy, v1.unit());
+  AddParticle(vertex, fPositron, energy, v2.unit());
+  event->AddPrimaryVertex(vertex);
+}
+
+// ---------------------------------------------------------------------------
+
+GammaLineGenerator::GammaLineGenerator(const G4double &defaultEnergy)
+    : fDefaultEnergy(defaultEnergy) {
+  fGamma = G4ParticleTable::GetParticleTable()->FindParticle("gamma");
+}
+
+void GammaLineGenerator::AddLine(G4double energy, G4double intensity) {
+  if (energy <= 0. || intensity <= 0.) {
+    G4cerr << "[GammaLineGenerator] Ignoring line with energy " << energy / MeV
+           << " MeV, intensity " << intensity << G4endl;
+    return;
+  }
+  G4double total = fCumulative.empty() ? 0. : fCumulative.back();
+  fEnergies.push_back(energy);
+  fCumulative.push_back(total + intensity);
+}
+
+void GammaLineGenerator::ClearLines() {
+  fEnergies.clear();
+  fCumulative.clear();
+}
+
+void GammaLineGenerator::Generate(G4Event *event,
+                                  const G4ThreeVector &vertexPos) {
+  G4double energy = fDefaultEnergy;
+  if (fEnergies.size() > 1) {
+    G4double r = G4UniformRand() * fCumulative.back();
+    size_t line =
+        std::upper_bound(fCumulative.begin(), fCumulative.end(), r) -
+        fCumulative.begin();
+    energy = fEnergies[std::min(line, fEnergies.size() - 1)];
+  } else if (fEnergies.size() == 1) {
+    energy = fEnergies[0];
+  }
+
+  auto vertex = new G4PrimaryVertex(vertexPos, 0.);
+  AddParticle(vertex, fGamma, energy, G4RandomDirection());
+  event->AddPrimaryVertex(vertex);
+}
+
+// ---------------------------------------------------------------------------
+
+AxionDecayGenerator::AxionDecayGenerator(const G4double &mass,
+                                         const G4double &totalEnergy)
+    : fMass(mass), fTotalEnergy(totalEnergy) {
+  fGamma = G4ParticleTable::GetParticleTable()->FindParticle("gamma");
+}
+
+void AxionDecayGenerator::Generate(G4Event *event,
+                                   const G4ThreeVector &vertexPos) {
+  // 静止系：两个光子各带 m/2，方向相反
+  G4double halfMass = 0.5 * fMass;
+  G4ThreeVector restDir = G4RandomDirection();
+  G4LorentzVector k1(halfMass * restDir, halfMass);
+  G4LorentzVector k2(-halfMass * restDir, halfMass);
+
+  // 推进到实验室系
+  if (fTotalEnergy > fMass) {
+    G4double beta = std::sqrt(1. - (fMass * fMass) /
+                                       (fTotalEnergy * fTotalEnergy));
+    G4ThreeVector boost = beta * G4RandomDirection();
+    k1.boost(boost);
+    k2.boost(boost);
+  }
+
+  auto vertex = new G4PrimaryVertex(vertexPos, 0.);
+  AddParticle(vertex, fGamma, k1.e(), k1.vect().unit());
+  AddParticle(vertex, fGamma, k2.e(), k2.vect().unit());
+  event->AddPrimaryVertex(vertex);
+}
+
+// ---------------------------------------------------------------------------
+
+VertexFileGenerator::VertexFileGenerator() {}
+
+G4int VertexFileGenerator::Load(const G4String &fileName) {
+  std::ifstream in(fileName);
+  if (!in) {
+    G4cerr << "[VertexFileGenerator] Cannot open vertex file: " << fileName
+           << G4endl;
+    return 0;
+  }
+
+  fParticles.clear();
+  fEventOffsets.clear();
+  G4long currentEvent = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream iss(line);
+    G4long eventNo;
+    Particle p;
+    G4double x, y, z, t, px, py, pz;
+    if (!(iss >> eventNo >> p.pdg >> x >> y >> z >> t >> px >> py >> pz))
+      continue;
+    p.position.set(x * mm, y * mm, z * mm);
+    p.time = t * ns;
+    p.momentum.set(px * MeV, py * MeV, pz * MeV);
+
+    if (fEventOffsets.empty() || eventNo != currentEvent) {
+      fEventOffsets.push_back(fParticles.size());
+      currentEvent = eventNo;
+    }
+    fParticles.push_back(p);
+  }
+  G4int nEvents = fEventOffsets.size();
+  fEventOffsets.push_back(fParticles.size());
+
+  G4cout << "[VertexFileGenerator] Loaded " << nEvents << " events ("
+         << fParticles.size() << " particles) from " << fileName << G4endl;
+  return nEvents;
+}
+
+void VertexFileGenerator::Generate(G4Event *event, const G4ThreeVector &) {
+  if (fParticles.empty()) {
+    G4cerr << "[VertexFileGenerator] No vertex file loaded, "
+              "use /CsI/generator/vertexFile"
+           << G4endl;
+    return;
+  }
+
+  size_t nEvents = fEventOffsets.size() - 1;
+  size_t entry = static_cast<size_t>(event->GetEventID()) % nEvents;
+  G4ParticleTable *particleTable = G4ParticleTable::GetParticleTable();
+
+  G4PrimaryVertex *vertex = nullptr;
+  for (size_t i = fEventOffsets[entry]; i < fEventOffsets[entry + 1]; i++) {
+    const Particle &p = fParticles[i];
+    G4ParticleDefinition *definition = particleTable->FindParticle(p.pdg);
+    if (!definition) {
+      G4cerr << "[VertexFileGenerator] Unknown PDG code " << p.pdg << G4endl;
+      continue;
+    }
+    if (!vertex || vertex->GetPosition() != p.position ||
+        vertex->GetT0() != p.time) {
+      vertex = new G4PrimaryVertex(p.position, p.time);
+      event->AddPrimaryVertex(vertex);
+    }
+    auto primary = new G4PrimaryParticle(definition);
+    primary->SetMomentum(p.momentum.x(), p.momentum.y(), p.momentum.z());
+    vertex->SetPrimary(primary);
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+MappedVertexGenerator::MappedVertexGenerator(const G4long &firstEntry)
+    : fFirstEntry(firstEntry), fMap(nullptr), fMapSize(0), fNEvents(0),
+      fOffsets(nullptr), fRecords(nullptr) {}
+
+MappedVertexGenerator::~MappedVertexGenerator() { Close(); }
+
+void MappedVertexGenerator::Close() {
+  if (fMap)
+    munmap(fMap, fMapSize);
+  fMap = nullptr;
+  fMapSize = 0;
+  fNEvents = 0;
+  fOffsets = nullptr;
+  fRecords = nullptr;
+}
+
+G4long MappedVertexGenerator::Open(const G4String &fileName) {
+  Close();
+
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    G4cerr << "[MappedVertexGenerator] Cannot open vertex file: " << fileName
+           << G4endl;
+    return 0;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+    G4cerr << "[MappedVertexGenerator] File too short: " << fileName << G4endl;
+    close(fd);
+    return 0;
+  }
+  size_t size = st.st_size;
+  void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // 映射在关闭文件描述符后仍然有效
+  if (map == MAP_FAILED) {
+    G4cerr << "[MappedVertexGenerator] mmap failed for " << fileName << G4endl;
+    return 0;
+  }
+
+  const Header *header = static_cast<const Header *>(map);
+  const char *base = static_cast<const char *>(map);
+  G4bool valid = std::memcmp(header->magic, "CSIVTX01", 8) == 0 &&
+                 header->recordSize == sizeof(Record) &&
+                 header->nEvents > 0 &&
+                 header->nEvents < size / sizeof(std::uint64_t) &&
+                 header->nParticles <= size / sizeof(Record);
+  size_t offsetsSize = (header->nEvents + 1) * sizeof(std::uint64_t);
+  size_t recordsSize = header->nParticles * sizeof(Record);
+  valid = valid && size >= sizeof(Header) + offsetsSize + recordsSize;
+  if (valid) {
+    auto offsets =
+        reinterpret_cast<const std::uint64_t *>(base + sizeof(Header));
+    valid = offsets[header->nEvents] == header->nParticles;
+    // Generate 直接用偏移量索引 record：偏移量必须单调不减且不超过粒子数，
+    // 否则损坏的文件会让它读到映射之外（打开时扫描一遍偏移表）
+    for (std::uint64_t i = 0; valid && i < header->nEvents; i++)
+      valid = offsets[i] <= offsets[i + 1] &&
+              offsets[i] <= header->nParticles;
+  }
+  if (!valid) {
+    G4cerr << "[MappedVertexGenerator] Not a valid vertex file: " << fileName
+           << G4endl;
+    munmap(map, size);
+    return 0;
+  }
+
+  fMap = map;
+  fMapSize = size;
+  fNEvents = header->nEvents;
+  fOffsets = reinterpret_cast<const std::uint64_t *>(base + sizeof(Header));
+  fRecords =
+      reinterpret_cast<const Record *>(base + sizeof(Header) + offsetsSize);
+
+  G4cout << "[MappedVertexGenerator] Mapped " << fNEvents << " events ("
+         << header->nParticles << " particles) from " << fileName << G4endl;
+  return fNEvents;
+}
+
+void MappedVertexGenerator::Generate(G4Event *event, const G4ThreeVector &) {
+  if (!fMap) {
+    G4cerr << "[MappedVertexGenerator] No vertex file mapped, "
+              "use /CsI/generator/vertexBinary"
+           << G4endl;
+    return;
+  }
+
+  std::uint64_t entry =
+      static_cast<std::uint64_t>(fFirstEntry + event->GetEventID()) %
+      fNEvents;
+  G4ParticleTable *particleTable = G4ParticleTable::GetParticleTable();
+
+  G4PrimaryVertex *vertex = nullptr;
+  for (std::uint64_t i = fOffsets[entry]; i < fOffsets[entry + 1]; i++) {
+    const Record &r = fRecords[i];
+    G4ParticleDefinition *definition = particleTable->FindParticle(r.pdg);
+    if (!definition) {
+      G4cerr << "[MappedVertexGenerator] Unknown PDG code " << r.pdg
+             << G4endl;
+      continue;
+    }
+    G4ThreeVector position(r.x * mm, r.y * mm, r.z * mm);
+    if (!vertex || vertex->GetPosition() != position ||
+        vertex->GetT0() != r.t * ns) {
+      vertex = new G4PrimaryVertex(position, r.t * ns);
+      vertex->SetWeight(r.weight);
+      event->AddPrimaryVertex(vertex);
+    }
+    auto primary = new G4PrimaryParticle(definition);
+    primary->SetMomentum(r.px * MeV, r.py * MeV, r.pz * MeV);
+    vertex->SetPrimary(primary);
+  }
+}
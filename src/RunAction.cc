@@ -1,60 +1,289 @@
 #include "RunAction.hh"
+#include "BenchmarkTimer.hh"
+#include "CrystalArray.hh"
+#include "DetectorConstruction.hh"
 #include "G4Run.hh"
 #include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "OutputWriter.hh"
+#include "PhysicsList.hh"
+#include "ShmEventSink.hh"
+#include "SteppingAction.hh"
+#include "StepStatistics.hh"
 #include <fstream>
 
 // #include "G4AnalysisManager.hh" // Not needed if included in header or using
 // g4root.hh
 
-RunAction::RunAction() : G4UserRunAction() {
+RunAction::RunAction()
+    : G4UserRunAction(), fMessenger(nullptr), fWriteNtuple(true),
+      fWriteHistograms(true), fWriteHitColumns(true), fWriteDigis(false),
+      fWriteWaveforms(false), fWriteClusters(false), fWriteTruth(false),
+      fAsyncOutput(false),
+      fQueueDepth(64), fOutputFileName("CsI_Axion"),
+      fCheckpoint(fOutputFileName), fSweep(fOutputFileName), fShmSlots(1024),
+      fShmSlotBytes(16384), fWriter(nullptr),
+      fBooked(false),
+      fNtupleBooked(false), fHistogramsBooked(false), fHitColumnsBooked(false),
+      fDigisBooked(false), fWaveformsBooked(false), fClustersBooked(false),
+      fTruthBooked(false),
+      fTimeBinsBooked(0), fHistEmax(10. * MeV),
+      fHistTmax(20. * ns), fH1TotalEdep(-1), fH1HitCount(-1),
+      fH1CrystalEdep(-1), fH1CrystalTime(-1), fH1PhotonExitTotal(-1),
+      fFill(&fRow) {
   // Create analysis manager
   auto analysisManager = G4AnalysisManager::Instance();
   analysisManager->SetVerboseLevel(1);
   analysisManager->SetNtupleMerging(true);
 
+  fMessenger =
+      new G4GenericMessenger(this, "/CsI/output/", "Output control");
+  fMessenger->DeclareProperty(
+      "ntuple", fWriteNtuple,
+      "Write the per-hit ntuple (disable for spectrum-only runs)");
+  fMessenger->DeclareProperty(
+      "fileName", fOutputFileName,
+      "Output file name without extension (default CsI_Axion)");
+  fMessenger->DeclareProperty("histograms", fWriteHistograms,
+                              "Book and fill the online histograms");
+  fMessenger->DeclareProperty(
+      "hitColumns", fWriteHitColumns,
+      "Write the per-hit MC truth columns (Crystal*) in the ntuple");
+  fMessenger->DeclareProperty(
+      "digis", fWriteDigis,
+      "Run the digitizer and write the Digi* ADC/TDC columns");
+  fMessenger->DeclareProperty(
+      "waveforms", fWriteWaveforms,
+      "Synthesize scintillation waveforms (Waveform* columns)");
+  fMessenger->DeclareProperty(
+      "clusters", fWriteClusters,
+      "Cluster neighbouring fired crystals (Cluster* columns)");
+  fMessenger->DeclareProperty(
+      "truth", fWriteTruth,
+      "Record secondaries above /CsI/truth/minEnergy (Truth* columns)");
+  fMessenger->DeclarePropertyWithUnit("histEmax", "MeV", fHistEmax,
+                                      "Upper edge of the energy histograms");
+  fMessenger->DeclarePropertyWithUnit("histTmax", "ns", fHistTmax,
+                                      "Upper edge of the time histogram");
+  fMessenger->DeclareProperty(
+      "async", fAsyncOutput,
+      "Hand ntuple rows to a writer thread instead of writing them in the "
+      "event loop");
+  fMessenger->DeclareProperty("queueDepth", fQueueDepth,
+                              "Rows queued for the writer thread before the "
+                              "event loop waits");
+  fMessenger->DeclareProperty(
+      "shmName", fShmName,
+      "Publish events to this POSIX shared-memory ring, e.g. /csi_events "
+      "(empty = off)");
+  fMessenger->DeclareProperty("shmSlots", fShmSlots,
+                              "Events held by the shared-memory ring");
+  fMessenger->DeclareProperty("shmSlotBytes", fShmSlotBytes,
+                              "Bytes per event slot in the shared-memory ring");
+}
+
+RunAction::~RunAction() {
+  delete fWriter;
+  delete fMessenger;
+  delete G4AnalysisManager::Instance();
+}
+
+void RunAction::BookNtuple() {
+  auto analysisManager = G4AnalysisManager::Instance();
+
+  // 有界内存模式：小 basket，缓冲满了就写到文件
+  if (fMemoryMonitor.GetBasketSize() > 0)
+    analysisManager->SetBasketSize(fMemoryMonitor.GetBasketSize());
+
   // Creating ntuple
   analysisManager->CreateNtuple("CsI", "CsI Hits");
   analysisManager->CreateNtupleIColumn("EventID");
   analysisManager->CreateNtupleDColumn("TotalEdep");
   analysisManager->CreateNtupleIColumn("HitCount");
-  // 使用 vector 存储每个 hit 的信息
-  analysisManager->CreateNtupleIColumn("CrystalID", fCrystalIDs);
-  analysisManager->CreateNtupleDColumn("CrystalEdep", fCrystalEdeps);
-  analysisManager->CreateNtupleDColumn("CrystalTime", fCrystalTimes);
-  analysisManager->CreateNtupleDColumn("CrystalPosX", fCrystalPosX);
-  analysisManager->CreateNtupleDColumn("CrystalPosY", fCrystalPosY);
-  analysisManager->CreateNtupleDColumn("CrystalPosZ", fCrystalPosZ);
-  analysisManager->CreateNtupleIColumn("CrystalPDG", fCrystalPDGs);
-  analysisManager->CreateNtupleIColumn("CrystalTrackID", fCrystalTrackIDs);
-  analysisManager->CreateNtupleIColumn("CrystalParentID", fCrystalParentIDs);
-  analysisManager->CreateNtupleDColumn("CrystalDirX", fCrystalDirX);
-  analysisManager->CreateNtupleDColumn("CrystalDirY", fCrystalDirY);
-  analysisManager->CreateNtupleDColumn("CrystalDirZ", fCrystalDirZ);
-  analysisManager->CreateNtupleDColumn("CrystalKineticEnergy",
-                                       fCrystalKineticEnergy);
-  analysisManager->CreateNtupleIColumn("CrystalProcessID", fCrystalProcessIDs);
-  analysisManager->CreateNtupleDColumn("CrystalTrackLength",
-                                       fCrystalTrackLength);
+  // 重要性抽样的事件权重（无偏置时为 1）
+  analysisManager->CreateNtupleDColumn("EventWeight");
+  // 触发过的 watchdog 上限（EventWatchdog::Flag 位掩码，0 = 正常）
+  analysisManager->CreateNtupleIColumn("WatchdogFlags");
+  // /CsI/sweep 的配置编号（见 <fileName>_SweepConfigs.txt，单个 run 为 0）
+  analysisManager->CreateNtupleIColumn("ConfigIndex");
+  // 有界内存模式下本事件的 vector 列被 maxHitEntries 截断（HitCount 和
+  // TotalEdep 仍包含全部 hit）
+  analysisManager->CreateNtupleIColumn("Truncated");
+  if (fWriteHitColumns)
+    BookHitColumns();
 
   // Primary Particle Columns
-  analysisManager->CreateNtupleIColumn("PrimaryPDG", fPrimaryPDG);
-  analysisManager->CreateNtupleDColumn("PrimaryEnergy", fPrimaryEnergy);
-  analysisManager->CreateNtupleDColumn("PrimaryPosX", fPrimaryPosX);
-  analysisManager->CreateNtupleDColumn("PrimaryPosY", fPrimaryPosY);
-  analysisManager->CreateNtupleDColumn("PrimaryPosZ", fPrimaryPosZ);
-  analysisManager->CreateNtupleDColumn("PrimaryDirX", fPrimaryDirX);
-  analysisManager->CreateNtupleDColumn("PrimaryDirY", fPrimaryDirY);
-  analysisManager->CreateNtupleDColumn("PrimaryDirZ", fPrimaryDirZ);
+  analysisManager->CreateNtupleIColumn("PrimaryPDG", fRow.primaryPDG);
+  analysisManager->CreateNtupleDColumn("PrimaryEnergy", fRow.primaryEnergy);
+  analysisManager->CreateNtupleDColumn("PrimaryPosX", fRow.primaryPosX);
+  analysisManager->CreateNtupleDColumn("PrimaryPosY", fRow.primaryPosY);
+  analysisManager->CreateNtupleDColumn("PrimaryPosZ", fRow.primaryPosZ);
+  analysisManager->CreateNtupleDColumn("PrimaryDirX", fRow.primaryDirX);
+  analysisManager->CreateNtupleDColumn("PrimaryDirY", fRow.primaryDirY);
+  analysisManager->CreateNtupleDColumn("PrimaryDirZ", fRow.primaryDirZ);
 
   // Photon Exit Columns
   analysisManager->CreateNtupleIColumn("PhotonExitCrystalID",
-                                       fPhotonExitCrystalIDs);
-  analysisManager->CreateNtupleIColumn("PhotonExitCount", fPhotonExitCounts);
+                                       fRow.photonExitCrystalIDs);
+  analysisManager->CreateNtupleIColumn("PhotonExitCount", fRow.photonExitCounts);
+
+  // Digi Columns
+  if (fWriteDigis) {
+    analysisManager->CreateNtupleIColumn("DigiCrystalID", fRow.digiCrystalIDs);
+    analysisManager->CreateNtupleIColumn("DigiADC", fRow.digiADCs);
+    analysisManager->CreateNtupleIColumn("DigiTDC", fRow.digiTDCs);
+  }
+
+  // Waveform Columns
+  if (fWriteWaveforms) {
+    analysisManager->CreateNtupleIColumn("WaveformCrystalID",
+                                         fRow.waveformCrystalIDs);
+    analysisManager->CreateNtupleFColumn("WaveformSamples", fRow.waveformSamples);
+  }
+
+  // Cluster Columns
+  if (fWriteClusters) {
+    analysisManager->CreateNtupleDColumn("ClusterEnergy", fRow.clusterEnergy);
+    analysisManager->CreateNtupleDColumn("ClusterPosX", fRow.clusterPosX);
+    analysisManager->CreateNtupleDColumn("ClusterPosY", fRow.clusterPosY);
+    analysisManager->CreateNtupleDColumn("ClusterPosZ", fRow.clusterPosZ);
+    analysisManager->CreateNtupleDColumn("ClusterTime", fRow.clusterTime);
+    analysisManager->CreateNtupleIColumn("ClusterSize", fRow.clusterSize);
+    analysisManager->CreateNtupleIColumn("ClusterSeedID", fRow.clusterSeedID);
+  }
+
+  // Truth Columns（过程 ID 同 CrystalProcessID，见 ProcessIDMap.txt）
+  if (fWriteTruth) {
+    analysisManager->CreateNtupleIColumn("TruthTrackID", fRow.truthTrackID);
+    analysisManager->CreateNtupleIColumn("TruthParentID", fRow.truthParentID);
+    analysisManager->CreateNtupleIColumn("TruthPDG", fRow.truthPDG);
+    analysisManager->CreateNtupleIColumn("TruthProcessID", fRow.truthProcessID);
+    analysisManager->CreateNtupleDColumn("TruthEnergy", fRow.truthEnergy);
+    analysisManager->CreateNtupleDColumn("TruthPosX", fRow.truthPosX);
+    analysisManager->CreateNtupleDColumn("TruthPosY", fRow.truthPosY);
+    analysisManager->CreateNtupleDColumn("TruthPosZ", fRow.truthPosZ);
+    analysisManager->CreateNtupleDColumn("TruthTime", fRow.truthTime);
+  }
 
   analysisManager->FinishNtuple();
 }
-RunAction::~RunAction() { delete G4AnalysisManager::Instance(); }
+
+void RunAction::BookHitColumns() {
+  auto analysisManager = G4AnalysisManager::Instance();
+
+  // 使用 vector 存储每个 hit 的信息
+  analysisManager->CreateNtupleIColumn("CrystalID", fRow.crystalIDs);
+  analysisManager->CreateNtupleIColumn("CrystalIndex", fRow.crystalIndices);
+  analysisManager->CreateNtupleDColumn("CrystalEdep", fRow.crystalEdeps);
+  analysisManager->CreateNtupleDColumn("CrystalTime", fRow.crystalTimes);
+  analysisManager->CreateNtupleDColumn("CrystalPosX", fRow.crystalPosX);
+  analysisManager->CreateNtupleDColumn("CrystalPosY", fRow.crystalPosY);
+  analysisManager->CreateNtupleDColumn("CrystalPosZ", fRow.crystalPosZ);
+  analysisManager->CreateNtupleIColumn("CrystalPDG", fRow.crystalPDGs);
+  analysisManager->CreateNtupleIColumn("CrystalTrackID", fRow.crystalTrackIDs);
+  analysisManager->CreateNtupleIColumn("CrystalParentID", fRow.crystalParentIDs);
+  analysisManager->CreateNtupleDColumn("CrystalDirX", fRow.crystalDirX);
+  analysisManager->CreateNtupleDColumn("CrystalDirY", fRow.crystalDirY);
+  analysisManager->CreateNtupleDColumn("CrystalDirZ", fRow.crystalDirZ);
+  analysisManager->CreateNtupleDColumn("CrystalKineticEnergy",
+                                       fRow.crystalKineticEnergy);
+  analysisManager->CreateNtupleIColumn("CrystalProcessID", fRow.crystalProcessIDs);
+  analysisManager->CreateNtupleDColumn("CrystalTrackLength",
+                                       fRow.crystalTrackLength);
+  // 每个 hit 的能量按来源初级粒子拆分，按 hit 顺序展平
+  // （每个 hit min(初级粒子数, 4) 个值，顺序同 PrimaryPDG）
+  analysisManager->CreateNtupleFColumn("CrystalPrimaryEdep",
+                                       fRow.crystalPrimaryEdeps);
+
+  // 时间分箱的能量沉积，按 hit 顺序展平
+  auto detector = static_cast<const DetectorConstruction *>(
+      G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if (detector && detector->GetTimeBinCount() > 0) {
+    analysisManager->CreateNtupleFColumn("CrystalTimeBinEdep",
+                                         fRow.crystalTimeBinEdeps);
+    fTimeBinsBooked = detector->GetTimeBinCount();
+  }
+}
+
+void RunAction::BookHistograms() {
+  auto analysisManager = G4AnalysisManager::Instance();
+  using namespace CrystalArray;
+
+  fH1TotalEdep = analysisManager->CreateH1(
+      "TotalEdep", "Total energy deposit per event", 200, 0., fHistEmax);
+  fH1HitCount =
+      analysisManager->CreateH1("HitCount", "Fired crystals per event",
+                                kNCrystals + 1, -0.5, kNCrystals + 0.5);
+  fH1CrystalEdep = analysisManager->CreateH1(
+      "CrystalEdep", "Energy deposit per fired crystal", 200, 0., fHistEmax);
+  fH1CrystalTime = analysisManager->CreateH1(
+      "CrystalTime", "First deposit time per fired crystal", 200, 0.,
+      fHistTmax);
+  fH1PhotonExitTotal = analysisManager->CreateH1(
+      "PhotonExitTotal", "Optical photons leaving crystals per event", 200,
+      0., 200000.);
+
+  // 每一层 (iz) 一张 ix-iy 占有率图
+  fH2Occupancy.clear();
+  fH2EdepMap.clear();
+  fH2PhotonExit.clear();
+  for (G4int iz = 0; iz < kNz; iz++) {
+    G4String layer = std::to_string(iz);
+    fH2Occupancy.push_back(analysisManager->CreateH2(
+        "Occupancy_z" + layer, "Fired crystal count, layer iz=" + layer, kNx,
+        -0.5, kNx - 0.5, kNy, -0.5, kNy - 0.5));
+    fH2EdepMap.push_back(analysisManager->CreateH2(
+        "EdepMap_z" + layer, "Energy deposit (MeV), layer iz=" + layer, kNx,
+        -0.5, kNx - 0.5, kNy, -0.5, kNy - 0.5));
+    fH2PhotonExit.push_back(analysisManager->CreateH2(
+        "PhotonExitMap_z" + layer, "Exiting optical photons, layer iz=" + layer,
+        kNx, -0.5, kNx - 0.5, kNy, -0.5, kNy - 0.5));
+  }
+}
+
+void RunAction::FillHistograms(G4AnalysisManager *analysisManager,
+                               const EventRecord &row) {
+  using namespace CrystalArray;
+  G4double weight = row.eventWeight;
+
+  analysisManager->FillH1(fH1TotalEdep, row.totalEdep, weight);
+  analysisManager->FillH1(fH1HitCount, row.hitCount, weight);
+
+  for (size_t i = 0; i < row.crystalIndices.size(); i++) {
+    G4int index = row.crystalIndices[i];
+    G4int ix = IndexX(index), iy = IndexY(index), iz = IndexZ(index);
+    analysisManager->FillH1(fH1CrystalEdep, row.crystalEdeps[i], weight);
+    analysisManager->FillH1(fH1CrystalTime, row.crystalTimes[i], weight);
+    analysisManager->FillH2(fH2Occupancy[iz], ix, iy, weight);
+    analysisManager->FillH2(fH2EdepMap[iz], ix, iy,
+                            row.crystalEdeps[i] / MeV * weight);
+  }
+
+  G4int photonTotal = 0;
+  for (size_t i = 0; i < row.photonExitCrystalIDs.size(); i++) {
+    G4int copyNo = row.photonExitCrystalIDs[i];
+    analysisManager->FillH2(fH2PhotonExit[CopyNoZ(copyNo)], CopyNoX(copyNo),
+                            CopyNoY(copyNo), row.photonExitCounts[i] * weight);
+    photonTotal += row.photonExitCounts[i];
+  }
+  analysisManager->FillH1(fH1PhotonExitTotal, photonTotal, weight);
+}
+
+void RunAction::PrintHistogramSummary() const {
+  auto analysisManager = G4AnalysisManager::Instance();
+  auto hTotal = analysisManager->GetH1(fH1TotalEdep);
+  auto hCount = analysisManager->GetH1(fH1HitCount);
+  if (!hTotal || !hCount)
+    return;
+
+  G4cout << "--------------------- Run summary ---------------------\n"
+         << " Events       : " << hTotal->entries() << "\n"
+         << " TotalEdep    : mean = " << hTotal->mean() / MeV
+         << " MeV, rms = " << hTotal->rms() / MeV << " MeV\n"
+         << " HitCount     : mean = " << hCount->mean()
+         << ", rms = " << hCount->rms() << G4endl;
+}
 
 int RunAction::GetProcessID(const G4String &processName) {
   if (fProcessMap.find(processName) == fProcessMap.end()) {
@@ -64,16 +293,202 @@ int RunAction::GetProcessID(const G4String &processName) {
   return fProcessMap[processName];
 }
 
-void RunAction::BeginOfRunAction(const G4Run *) {
+G4long RunAction::GetNtupleRowBytes() const {
+  if (fWriter)
+    return fWriter->Bytes();
+  return fFill ? fFill->Bytes() : 0;
+}
+
+void RunAction::BeginRow() {
+  if (!fFill)
+    fFill = fWriter->Acquire();
+}
+
+void RunAction::EndRow(G4int eventID, G4double totalEdep, G4int hitCount,
+                       G4double weight, G4bool truncated) {
+  fFill->eventID = eventID;
+  fFill->totalEdep = totalEdep;
+  fFill->hitCount = hitCount;
+  fFill->eventWeight = weight;
+  fFill->watchdogFlags = fWatchdog.GetEventFlags();
+  fFill->configIndex = fSweep.GetConfigIndex();
+  fFill->truncated = truncated;
+
+  auto &sink = ShmEventSink::Instance();
+  if (sink.IsOpen()) {
+    sink.Publish(*fFill);
+    // 在线分析已达到目标精度：软中止本线程的 run
+    if (sink.StopRequested())
+      G4RunManager::GetRunManager()->AbortRun(true);
+  }
+
+  // 异步输出时直方图和 ntuple 都由写线程填写
+  if (fWriter) {
+    fWriter->Push(fFill);
+    fFill = nullptr;
+    return;
+  }
+
   auto analysisManager = G4AnalysisManager::Instance();
-  G4String fileName = "CsI_Axion";
-  analysisManager->OpenFile(fileName);
+  if (fHistogramsBooked)
+    FillHistograms(analysisManager, *fFill);
+  if (!fNtupleBooked)
+    return;
+
+  analysisManager->FillNtupleIColumn(0, eventID);
+  analysisManager->FillNtupleDColumn(1, totalEdep);
+  analysisManager->FillNtupleIColumn(2, hitCount);
+  analysisManager->FillNtupleDColumn(3, weight);
+  analysisManager->FillNtupleIColumn(4, fFill->watchdogFlags);
+  analysisManager->FillNtupleIColumn(5, fFill->configIndex);
+  analysisManager->FillNtupleIColumn(6, fFill->truncated);
+  // vector columns are automatically filled because they are bound by reference
+  analysisManager->AddNtupleRow();
 }
 
-void RunAction::EndOfRunAction(const G4Run *) {
+void RunAction::CheckpointIfDue(G4int eventID) {
+  if (!fCheckpoint.IsDue(eventID + 1))
+    return;
+
+  // 关闭当前 part（写线程先写完队列中的行），保存状态，打开下一个 part
+  if (fWriter)
+    fWriter->Stop();
   auto analysisManager = G4AnalysisManager::Instance();
   analysisManager->Write();
   analysisManager->CloseFile();
+  fCheckpoint.Save(eventID + 1, fProcessMap);
+  analysisManager->OpenFile(fCheckpoint.PartFileName());
+  if (fWriter)
+    fWriter->Start();
+}
+
+void RunAction::BeginOfRunAction(const G4Run *run) {
+  auto analysisManager = G4AnalysisManager::Instance();
+
+  // 在第一次 run 开始时按 /CsI/output/ 的设置创建 ntuple 和直方图
+  // （之后的 run 沿用同一套 booking）
+  if (!fBooked) {
+    if (fWriteNtuple)
+      BookNtuple();
+    if (fWriteHistograms)
+      BookHistograms();
+    fNtupleBooked = fWriteNtuple;
+    fHitColumnsBooked = fWriteHitColumns;
+    fDigisBooked = fWriteDigis;
+    fWaveformsBooked = fWriteWaveforms;
+    fClustersBooked = fWriteClusters;
+    fTruthBooked = fWriteTruth;
+    fHistogramsBooked = fWriteHistograms;
+    fBooked = true;
+  }
+
+  // 物理表在 BeginOfRunAction 之前已经建好（或读入）
+  if (IsMaster()) {
+    auto physicsList = dynamic_cast<const PhysicsList *>(
+        G4RunManager::GetRunManager()->GetUserPhysicsList());
+    if (physicsList)
+      const_cast<PhysicsList *>(physicsList)->EndOfStartup();
+  }
+
+#ifdef CSI_BENCHMARK
+  if (IsMaster())
+    BenchmarkTimer::RunTotals().Reset();
+#endif
+
+  if (fSweep.IsRunning()) {
+    // 参数扫描：全部配置写到一个文件，在第一个配置打开
+    if (fSweep.IsFirstConfig())
+      analysisManager->OpenFile(fOutputFileName);
+  } else {
+    // 检查点模式下输出按 part 分段（续跑时接着上次的 part）
+    fCheckpoint.BeginRun(run->GetNumberOfEventToBeProcessed(), fProcessMap);
+    analysisManager->OpenFile(fCheckpoint.IsActive()
+                                  ? fCheckpoint.PartFileName()
+                                  : fOutputFileName);
+  }
+
+  // 共享内存事件流（各线程共用一个段，重复打开无操作）
+  ShmEventSink::Instance().Open(fShmName, fShmSlots, fShmSlotBytes);
+  if (IsMaster())
+    ShmEventSink::Instance().SetRunID(run->GetRunID());
+
+  // 异步输出：处理事件的线程各起一个写线程
+  G4bool processesEvents =
+      !IsMaster() || !G4Threading::IsMultithreadedApplication();
+  if (fNtupleBooked && fAsyncOutput && processesEvents) {
+    OutputWriter::HistogramFiller fillHistograms;
+    if (fHistogramsBooked)
+      fillHistograms = [this](G4AnalysisManager *manager,
+                              const EventRecord &row) {
+        FillHistograms(manager, row);
+      };
+    fWriter = new OutputWriter(fQueueDepth, &fRow, fillHistograms);
+    fWriter->Start();
+    fFill = nullptr;
+  }
+
+#ifdef CSI_BENCHMARK
+  if (IsMaster())
+    BenchmarkTimer::StartEventLoop();
+#endif
+}
+
+void RunAction::EndOfRunAction(const G4Run *) {
+#ifdef CSI_BENCHMARK
+  if (IsMaster())
+    BenchmarkTimer::StopEventLoop();
+#endif
+  auto analysisManager = G4AnalysisManager::Instance();
+
+  // 先写完队列中的行（和它们的直方图），再写文件
+  if (fWriter) {
+    fWriter->Stop();
+    delete fWriter;
+    fWriter = nullptr;
+    fFill = &fRow;
+  }
+
+  // 多线程时各 worker 的直方图在 Write() 时合并到 master
+  if (fHistogramsBooked && IsMaster())
+    PrintHistogramSummary();
+
+  // 参数扫描：文件在最后一个配置之后才写出和关闭
+  if (!fSweep.IsRunning() || fSweep.IsLastConfig()) {
+    analysisManager->Write();
+    analysisManager->CloseFile();
+  }
+  fCheckpoint.EndRun();
+
+#ifdef CSI_BENCHMARK
+  // worker 先结束，master 最后合并并输出全部线程的合计
+  BenchmarkTimer::MergeThread();
+  if (IsMaster()) {
+    G4cout << "--- User action profile ---" << G4endl;
+    BenchmarkTimer::Print(BenchmarkTimer::RunTotals(), G4cout);
+    std::ofstream profileFile("UserActionProfile.txt");
+    BenchmarkTimer::Print(BenchmarkTimer::RunTotals(), profileFile);
+    G4cout << "User action profile saved to 'UserActionProfile.txt'"
+           << G4endl;
+  }
+#endif
+
+  // 内存高水位：worker 先合并，master 在 run 总结中打印
+  fMemoryMonitor.Merge();
+  if (IsMaster())
+    MemoryMonitor::PrintMerged();
+
+  // 失控事件的频率，同样先合并再由 master 打印
+  fWatchdog.Merge();
+  if (IsMaster())
+    EventWatchdog::PrintMerged();
+
+  // 步数统计：每个线程先合并到全局表，master 最后写出
+  auto steppingAction = static_cast<const SteppingAction *>(
+      G4RunManager::GetRunManager()->GetUserSteppingAction());
+  if (steppingAction)
+    const_cast<SteppingAction *>(steppingAction)->GetStepStatistics().Merge();
+  if (IsMaster())
+    StepStatistics::WriteMerged("StepStatistics.txt");
 
   // Save Process Mapping to file
   if (IsMaster()) {
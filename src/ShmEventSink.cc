@@ -0,0 +1,166 @@
+// ShmEventSink.cc
+#include "ShmEventSink.hh"
+#include "G4AutoLock.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace ShmLayout;
+
+namespace {
+G4Mutex sinkMutex = G4MUTEX_INITIALIZER;
+
+// 把 n 个元素复制到列块，返回写入后的偏移（8 字节对齐）
+template <typename T>
+uint64_t CopyColumn(char *slot, uint64_t offset, const T *data, size_t n) {
+  if (n > 0)
+    std::memcpy(slot + offset, data, n * sizeof(T));
+  return (offset + n * sizeof(T) + 7) & ~7ULL;
+}
+} // namespace
+
+ShmEventSink &ShmEventSink::Instance() {
+  static ShmEventSink sink;
+  return sink;
+}
+
+ShmEventSink::ShmEventSink()
+    : fNSlots(0), fSlotBytes(0), fSize(0), fBase(nullptr), fHeader(nullptr),
+      fDropped(0) {}
+
+ShmEventSink::~ShmEventSink() { Close(); }
+
+void ShmEventSink::Open(const G4String &name, G4int nSlots, G4int slotBytes) {
+  G4AutoLock lock(&sinkMutex);
+  if (fHeader && name == fName && nSlots == fNSlots &&
+      slotBytes == fSlotBytes)
+    return;
+  Close();
+  if (name.empty())
+    return;
+
+  nSlots = std::max(nSlots, 1);
+  slotBytes = std::max<G4int>(slotBytes, kSlotHeaderBytes + 64);
+  slotBytes = (slotBytes + 63) & ~63; // 槽按 cache line 对齐
+  size_t size = kHeaderBytes + static_cast<size_t>(nSlots) * slotBytes;
+
+  // 旧的段可能大小不同，重新创建
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+  if (fd < 0 || ftruncate(fd, size) != 0) {
+    G4cerr << "[ShmEventSink] Cannot create shared memory " << name << G4endl;
+    if (fd >= 0)
+      close(fd);
+    return;
+  }
+  void *base =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    G4cerr << "[ShmEventSink] Cannot map shared memory " << name << G4endl;
+    return;
+  }
+
+  // ftruncate 后内容为 0：所有槽 seq = 0, index = 0
+  fBase = static_cast<char *>(base);
+  fSize = size;
+  fName = name;
+  fNSlots = nSlots;
+  fSlotBytes = slotBytes;
+  fDropped = 0;
+  auto header = reinterpret_cast<Header *>(fBase);
+  header->version = kVersion;
+  header->nSlots = nSlots;
+  header->slotBytes = slotBytes;
+  header->dataOffset = kHeaderBytes;
+  header->writeIndex.store(0);
+  header->stopRequested.store(0);
+  header->runID = -1;
+  // magic 最后写，读取方看到 magic 时其余字段已就绪
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, kMagic, sizeof(kMagic));
+  fHeader = header;
+
+  G4cout << "[ShmEventSink] Streaming events to shared memory " << name << " ("
+         << nSlots << " slots x " << slotBytes << " bytes)" << G4endl;
+}
+
+void ShmEventSink::Close() {
+  if (!fBase)
+    return;
+  if (fDropped > 0)
+    G4cout << "[ShmEventSink] " << fDropped
+           << " events dropped (slot still being written)" << G4endl;
+  // 段本身保留，读取方可以读完最后的事件；需要时 rm /dev/shm/<name>
+  munmap(fBase, fSize);
+  fBase = nullptr;
+  fHeader = nullptr;
+}
+
+void ShmEventSink::SetRunID(G4int runID) {
+  if (!fHeader)
+    return;
+  fHeader->runID = runID;
+  // 上一个 run 的中止请求不延续到新的 run
+  fHeader->stopRequested.store(0);
+}
+
+G4bool ShmEventSink::StopRequested() const {
+  return fHeader &&
+         fHeader->stopRequested.load(std::memory_order_relaxed) != 0;
+}
+
+void ShmEventSink::Publish(const EventRecord &record) {
+  if (!fHeader)
+    return;
+
+  uint64_t index = fHeader->writeIndex.fetch_add(1, std::memory_order_relaxed);
+  char *slot = fBase + kHeaderBytes + (index % fNSlots) * fSlotBytes;
+  auto slotHeader = reinterpret_cast<SlotHeader *>(slot);
+
+  // seqlock: 偶数 -> 奇数；失败说明另一个线程正在写这个槽
+  uint64_t seq = slotHeader->seq.load(std::memory_order_relaxed);
+  if ((seq & 1) || !slotHeader->seq.compare_exchange_strong(
+                       seq, seq + 1, std::memory_order_acquire)) {
+    fDropped++;
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // 按槽容量截断：每个 hit 20 字节，每个光子出射记录 8 字节（另加对齐）
+  size_t capacity = fSlotBytes - kSlotHeaderBytes - kNColumns * 8;
+  size_t nHits = record.crystalIDs.size();
+  size_t nExit = record.photonExitCrystalIDs.size();
+  uint32_t flags = record.truncated ? kTruncated : 0;
+  if (nHits * 20 + nExit * 8 > capacity) {
+    flags |= kTruncated;
+    nHits = std::min(nHits, capacity / 20);
+    nExit = std::min(nExit, (capacity - nHits * 20) / 8);
+  }
+
+  slotHeader->index = index;
+  slotHeader->eventID = record.eventID;
+  slotHeader->nHits = nHits;
+  slotHeader->totalEdep = record.totalEdep;
+  slotHeader->eventWeight = record.eventWeight;
+  slotHeader->nPhotonExit = nExit;
+  slotHeader->flags = flags;
+
+  uint64_t offset = kSlotHeaderBytes;
+  slotHeader->offsets[kCrystalEdep] = offset;
+  offset = CopyColumn(slot, offset, record.crystalEdeps.data(), nHits);
+  slotHeader->offsets[kCrystalTime] = offset;
+  offset = CopyColumn(slot, offset, record.crystalTimes.data(), nHits);
+  slotHeader->offsets[kCrystalID] = offset;
+  offset = CopyColumn(slot, offset, record.crystalIDs.data(), nHits);
+  slotHeader->offsets[kPhotonExitCrystalID] = offset;
+  offset = CopyColumn(slot, offset, record.photonExitCrystalIDs.data(), nExit);
+  slotHeader->offsets[kPhotonExitCount] = offset;
+  CopyColumn(slot, offset, record.photonExitCounts.data(), nExit);
+
+  slotHeader->seq.store(seq + 2, std::memory_order_release);
+}
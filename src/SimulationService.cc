@@ -0,0 +1,164 @@
+// SimulationService.cc
+#include "SimulationService.hh"
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "G4ios.hh"
+#include "PhysicsList.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+const char *kRequestSuffix = ".mac";
+const char *kStopFile = "STOP";
+// 输出文件名由服务决定，请求不能改
+const char *kFileNameCommand = "/CsI/output/fileName";
+// 没有请求时的轮询间隔
+const std::chrono::milliseconds kPollInterval(500);
+} // namespace
+
+SimulationService::SimulationService(const G4String &spoolDir)
+    : fSpoolDir(spoolDir) {}
+
+G4String SimulationService::Path(const G4String &fileName) const {
+  return fSpoolDir + "/" + fileName;
+}
+
+std::vector<G4String> SimulationService::ListRequests() const {
+  std::vector<G4String> names;
+  DIR *dir = opendir(fSpoolDir.c_str());
+  if (!dir)
+    return names;
+  const size_t suffixLength = std::char_traits<char>::length(kRequestSuffix);
+  while (dirent *entry = readdir(dir)) {
+    std::string fileName = entry->d_name;
+    if (fileName.size() > suffixLength &&
+        fileName.compare(fileName.size() - suffixLength, suffixLength,
+                         kRequestSuffix) == 0)
+      names.push_back(fileName.substr(0, fileName.size() - suffixLength));
+  }
+  closedir(dir);
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+G4bool SimulationService::Claim(const G4String &name) const {
+  // rename 是原子的：只有一个服务进程能拿到这个请求
+  G4String request = Path(name + kRequestSuffix);
+  return rename(request.c_str(), (request + ".running").c_str()) == 0;
+}
+
+G4bool SimulationService::ExecuteMacro(const G4String &fileName) const {
+  std::ifstream in(fileName);
+  if (!in) {
+    G4cerr << "[SimulationService] Cannot open " << fileName << G4endl;
+    return false;
+  }
+  // /control/execute 只报告宏能否打开，宏中的错误不反映在返回值里
+  auto UImanager = G4UImanager::GetUIpointer();
+  std::string line;
+  G4int lineNo = 0;
+  while (std::getline(in, line)) {
+    lineNo++;
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#')
+      continue;
+    G4String command = line.substr(first);
+    if (command.rfind(kFileNameCommand, 0) == 0) {
+      G4cerr << "[SimulationService] " << fileName << ":" << lineNo
+             << " requests may not set the output file name (written to "
+             << "<spoolDir>/<name>.root)" << G4endl;
+      return false;
+    }
+    G4int status = UImanager->ApplyCommand(command);
+    if (status != 0) {
+      G4cerr << "[SimulationService] " << fileName << ":" << lineNo << " '"
+             << command << "' failed (status " << status << ")" << G4endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+G4bool SimulationService::Execute(const G4String &name) const {
+  G4String running = Path(name + kRequestSuffix) + ".running";
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::cout.flush();
+  std::cerr.flush();
+  pid_t pid = fork();
+  if (pid == 0) {
+    // 同名请求以前的输出不能当作这次的结果
+    G4String output = Path(name) + ".root";
+    std::remove(output.c_str());
+    auto UImanager = G4UImanager::GetUIpointer();
+    G4bool ok = UImanager->ApplyCommand(G4String(kFileNameCommand) + " " +
+                                        Path(name)) == 0 &&
+                ExecuteMacro(running);
+    if (ok && access(output.c_str(), F_OK) != 0) {
+      G4cerr << "[SimulationService] " << name << " wrote no " << output
+             << G4endl;
+      ok = false;
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    _exit(ok ? 0 : 1);
+  }
+  int status = 0;
+  G4bool ok = pid > 0 && waitpid(pid, &status, 0) == pid &&
+              WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  G4double seconds = std::chrono::duration<G4double>(
+                         std::chrono::steady_clock::now() - t0)
+                         .count();
+
+  G4String finished = Path(name + kRequestSuffix) + (ok ? ".done" : ".failed");
+  rename(running.c_str(), finished.c_str());
+  G4cout << "[SimulationService] " << name << (ok ? " done" : " FAILED")
+         << " in " << seconds << " s";
+  if (pid > 0 && WIFSIGNALED(status))
+    G4cout << " (signal " << WTERMSIG(status) << ")";
+  G4cout << G4endl;
+  return ok;
+}
+
+void SimulationService::Run() {
+  // 空 run 只构建物理表（不调用用户的 run action、不打开输出），
+  // 写出物理表缓存；之后 fork 的请求直接从事件循环开始
+  auto runManager = G4RunManager::GetRunManager();
+  runManager->BeamOn(0);
+  auto physicsList = dynamic_cast<const PhysicsList *>(
+      runManager->GetUserPhysicsList());
+  if (physicsList)
+    const_cast<PhysicsList *>(physicsList)->EndOfStartup();
+
+  G4cout << "[SimulationService] Waiting for requests in " << fSpoolDir
+         << " (create " << Path(kStopFile) << " to stop)" << G4endl;
+
+  G4int nDone = 0, nFailed = 0;
+  while (access(Path(kStopFile).c_str(), F_OK) != 0) {
+    G4bool idle = true;
+    for (const auto &name : ListRequests()) {
+      if (!Claim(name))
+        continue; // 被其他服务进程拿走了
+      idle = false;
+      if (Execute(name))
+        nDone++;
+      else
+        nFailed++;
+      // 每个请求之后重新检查 STOP
+      break;
+    }
+    if (idle)
+      std::this_thread::sleep_for(kPollInterval);
+  }
+
+  G4cout << "[SimulationService] Stopping: " << nDone << " requests done, "
+         << nFailed << " failed" << G4endl;
+}
@@ -0,0 +1,179 @@
+// StepStatistics.cc
+#include "StepStatistics.hh"
+#include "G4AutoLock.hh"
+#include "G4LogicalVolume.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VProcess.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <tuple>
+
+namespace {
+// 打包键: 体积、粒子、过程各占 20 位
+constexpr G4int kIDBits = 20;
+
+struct MergedEntry {
+  G4long steps = 0;
+  G4long tracks = 0;
+  G4double seconds = 0.;
+};
+using MergedKey = std::tuple<G4String, G4String, G4String>;
+
+std::map<MergedKey, MergedEntry> &MergedTable() {
+  static std::map<MergedKey, MergedEntry> table;
+  return table;
+}
+
+G4Mutex mergeMutex = G4MUTEX_INITIALIZER;
+} // namespace
+
+StepStatistics::StepStatistics()
+    : fMessenger(nullptr), fEnabled(false), fLastVolume(nullptr),
+      fLastParticle(nullptr), fLastProcess(nullptr), fLastSlot(-1) {
+  fMessenger = new G4GenericMessenger(this, "/CsI/stepStats/",
+                                      "Step accounting per volume/particle");
+  fMessenger->DeclareProperty(
+      "enable", fEnabled,
+      "Count steps, tracks and CPU time per (volume, particle, process) and "
+      "write StepStatistics.txt at the end of the run");
+}
+
+StepStatistics::~StepStatistics() { delete fMessenger; }
+
+G4int StepStatistics::VolumeID(const G4LogicalVolume *volume) {
+  auto it = fVolumeIDs.find(volume);
+  if (it != fVolumeIDs.end())
+    return it->second;
+  G4int id = fVolumeNames.size();
+  fVolumeNames.push_back(volume ? volume->GetName() : G4String("OutOfWorld"));
+  fVolumeIDs[volume] = id;
+  return id;
+}
+
+G4int StepStatistics::ParticleID(const G4ParticleDefinition *particle) {
+  auto it = fParticleIDs.find(particle);
+  if (it != fParticleIDs.end())
+    return it->second;
+  G4int id = fParticleNames.size();
+  fParticleNames.push_back(particle->GetParticleName());
+  fParticleIDs[particle] = id;
+  return id;
+}
+
+G4int StepStatistics::ProcessID(const G4VProcess *process) {
+  auto it = fProcessIDs.find(process);
+  if (it != fProcessIDs.end())
+    return it->second;
+  G4int id = fProcessNames.size();
+  fProcessNames.push_back(process ? process->GetProcessName()
+                                  : G4String("primary"));
+  fProcessIDs[process] = id;
+  return id;
+}
+
+StepStatistics::Entry &StepStatistics::Slot(G4int volumeID, G4int particleID,
+                                            G4int processID) {
+  G4long key = (((static_cast<G4long>(volumeID) << kIDBits) | particleID)
+                << kIDBits) |
+               processID;
+  auto it = fSlotOfKey.find(key);
+  if (it != fSlotOfKey.end())
+    return fEntries[it->second];
+  fSlotOfKey[key] = fEntries.size();
+  fKeys.push_back(key);
+  fEntries.emplace_back();
+  return fEntries.back();
+}
+
+void StepStatistics::BeginTrack(const G4Track *track) {
+  const G4LogicalVolume *volume =
+      track->GetTouchable() && track->GetTouchable()->GetVolume()
+          ? track->GetTouchable()->GetVolume()->GetLogicalVolume()
+          : nullptr;
+  Slot(VolumeID(volume), ParticleID(track->GetDefinition()),
+       ProcessID(track->GetCreatorProcess()))
+      .tracks++;
+  fLastTime = std::chrono::steady_clock::now();
+}
+
+void StepStatistics::AddStep(const G4Step *step) {
+  auto now = std::chrono::steady_clock::now();
+  G4double seconds = std::chrono::duration<G4double>(now - fLastTime).count();
+  fLastTime = now;
+
+  const void *volume =
+      step->GetPreStepPoint()->GetPhysicalVolume()->GetLogicalVolume();
+  const void *particle = step->GetTrack()->GetDefinition();
+  const void *process = step->GetPostStepPoint()->GetProcessDefinedStep();
+
+  if (fLastSlot < 0 || volume != fLastVolume || particle != fLastParticle ||
+      process != fLastProcess) {
+    Entry &entry =
+        Slot(VolumeID(static_cast<const G4LogicalVolume *>(volume)),
+             ParticleID(static_cast<const G4ParticleDefinition *>(particle)),
+             ProcessID(static_cast<const G4VProcess *>(process)));
+    fLastSlot = &entry - fEntries.data();
+    fLastVolume = volume;
+    fLastParticle = particle;
+    fLastProcess = process;
+  }
+  Entry &entry = fEntries[fLastSlot];
+  entry.steps++;
+  entry.seconds += seconds;
+}
+
+void StepStatistics::Merge() {
+  const G4long mask = (1L << kIDBits) - 1;
+  {
+    G4AutoLock lock(&mergeMutex);
+    auto &table = MergedTable();
+    for (size_t i = 0; i < fEntries.size(); i++) {
+      G4long key = fKeys[i];
+      MergedEntry &merged =
+          table[MergedKey(fVolumeNames[key >> (2 * kIDBits)],
+                          fParticleNames[(key >> kIDBits) & mask],
+                          fProcessNames[key & mask])];
+      merged.steps += fEntries[i].steps;
+      merged.tracks += fEntries[i].tracks;
+      merged.seconds += fEntries[i].seconds;
+    }
+  }
+  fSlotOfKey.clear();
+  fKeys.clear();
+  fEntries.clear();
+  // 几何可能在 run 之间重建 (/CsI/sweep)，逻辑体指针只在一个 run 内有效
+  fVolumeIDs.clear();
+  fVolumeNames.clear();
+  fLastSlot = -1;
+}
+
+void StepStatistics::WriteMerged(const G4String &fileName) {
+  G4AutoLock lock(&mergeMutex);
+  auto &table = MergedTable();
+  if (table.empty())
+    return;
+
+  std::vector<std::pair<MergedKey, MergedEntry>> rows(table.begin(),
+                                                      table.end());
+  std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+    return a.second.steps > b.second.steps;
+  });
+
+  std::ofstream outFile(fileName);
+  outFile << "Volume\tParticle\tProcess\tSteps\tTracks\tSeconds" << G4endl;
+  for (const auto &row : rows) {
+    outFile << std::get<0>(row.first) << "\t" << std::get<1>(row.first)
+            << "\t" << std::get<2>(row.first) << "\t" << row.second.steps
+            << "\t" << row.second.tracks << "\t" << row.second.seconds
+            << G4endl;
+  }
+  outFile.close();
+  table.clear();
+  G4cout << "Step statistics saved to '" << fileName << "'" << G4endl;
+}
@@ -1,15 +1,41 @@
 #include "SteppingAction.hh"
+#include "BenchmarkTimer.hh"
+#include "CrystalArray.hh"
+#include "DetectorConstruction.hh"
+#include "EventWatchdog.hh"
+#include "G4RunManager.hh"
+#include "G4OpBoundaryProcess.hh"
 #include "G4OpticalPhoton.hh"
+#include "G4ProcessManager.hh"
 #include "G4Step.hh"
 #include "G4StepPoint.hh"
 #include "G4Track.hh"
 #include "G4ios.hh"
+#include "RunAction.hh"
 
-SteppingAction::SteppingAction() {}
+SteppingAction::SteppingAction()
+    : fWatchdog(nullptr), fSurfaceKnown(false), fSurfaceStatus(-1),
+      fBoundary(nullptr),
+      fPhotonExitCounts(CrystalArray::kNCrystals, 0) {
+  fExitedCrystals.reserve(CrystalArray::kNCrystals);
+}
 
 SteppingAction::~SteppingAction() {}
 
 void SteppingAction::UserSteppingAction(const G4Step *step) {
+  CSI_BENCH_SCOPE(kSteppingAction);
+  CSI_BENCH_COUNT(kSteps, 1);
+  if (fStepStatistics.IsEnabled())
+    fStepStatistics.AddStep(step);
+
+  if (!fWatchdog) {
+    auto runAction = static_cast<const RunAction *>(
+        G4RunManager::GetRunManager()->GetUserRunAction());
+    fWatchdog = &const_cast<RunAction *>(runAction)->GetWatchdog();
+  }
+  if (fWatchdog->IsEnabled())
+    fWatchdog->CheckStep(step);
+
   G4Track *track = step->GetTrack();
   if (track->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition())
     return;
@@ -23,15 +49,51 @@ void SteppingAction::UserSteppingAction(const G4Step *step) {
   // Determine pre/post volumes
   G4VPhysicalVolume *preVol = prePoint->GetPhysicalVolume();
   G4VPhysicalVolume *postVol = postPoint->GetPhysicalVolume();
-  G4String preName = preVol ? preVol->GetName() : "";
-  G4String postName = postVol ? postVol->GetName() : "";
-
-  // If photon goes from CsI to World, count it for that crystal
-  if (preName == "CsI" && postName == "World") {
-    // G4cout << "Photon exited CsI crystal\n";
-    G4int crystalID = prePoint->GetTouchable()->GetCopyNumber();
-    fPhotonExitCounts[crystalID]++;
+  if (!preVol || preVol->GetName() != "CsI")
+    return;
+
+  // 晶体放在 Gap 体积内，光子离开晶体时进入的是 Gap（或相邻晶体之外的
+  // 任何体积），不是 World
+  if (postVol && postVol->GetName() == "CsI")
+    return;
+
+  // 表面模式：光子在第一次到达晶体面时终止，按表面的结果计数
+  if (!fSurfaceKnown)
+    FindBoundaryProcess(track);
+  if (fSurfaceStatus >= 0 &&
+      (!fBoundary || fBoundary->GetStatus() != fSurfaceStatus))
+    return;
+
+  G4int index = prePoint->GetTouchable()->GetCopyNumber();
+  if (fPhotonExitCounts[index]++ == 0)
+    fExitedCrystals.push_back(index);
+}
+
+void SteppingAction::FindBoundaryProcess(const G4Track *track) {
+  auto detector = static_cast<const DetectorConstruction *>(
+      G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  G4String mode = detector ? detector->GetSurfaceMode() : G4String("none");
+  if (mode == "absorb")
+    fSurfaceStatus = Absorption;
+  else if (mode == "detect")
+    fSurfaceStatus = Detection;
+  else
+    fSurfaceStatus = -1;
+  fSurfaceKnown = true;
+
+  G4ProcessManager *processManager =
+      track->GetDefinition()->GetProcessManager();
+  G4ProcessVector *processes = processManager->GetProcessList();
+  for (G4int i = 0; i < processManager->GetProcessListLength(); i++) {
+    if ((*processes)[i]->GetProcessName() == "OpBoundary") {
+      fBoundary = static_cast<G4OpBoundaryProcess *>((*processes)[i]);
+      break;
+    }
   }
 }
 
-void SteppingAction::ResetCounts() { fPhotonExitCounts.clear(); }
\ No newline at end of file
+void SteppingAction::ResetCounts() {
+  for (G4int index : fExitedCrystals)
+    fPhotonExitCounts[index] = 0;
+  fExitedCrystals.clear();
+}
\ No newline at end of file
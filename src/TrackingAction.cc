@@ -1,15 +1,55 @@
 // TrackingAction.cc
 #include "TrackingAction.hh"
+#include "BenchmarkTimer.hh"
 #include "G4EventManager.hh"
 #include "G4OpticalPhoton.hh"
+#include "G4RunManager.hh"
 #include "G4Track.hh"
+#include "G4StackManager.hh"
 #include "G4TrackingManager.hh"
+#include "RunAction.hh"
+#include "SteppingAction.hh"
 #include "Trajectory.hh"
 
-TrackingAction::TrackingAction() = default;
+#include <algorithm>
+
+TrackingAction::TrackingAction()
+    : fPrimaryOfTrack(1024, 0), fStepStatistics(nullptr),
+      fMemoryMonitor(nullptr), fSavedStoreTrajectory(-1),
+      fTruthEnabled(false) {}
 TrackingAction::~TrackingAction() = default;
 
 void TrackingAction::PreUserTrackingAction(const G4Track *track) {
+  CSI_BENCH_SCOPE(kTrackingAction);
+  if (!fStepStatistics) {
+    auto steppingAction = static_cast<const SteppingAction *>(
+        G4RunManager::GetRunManager()->GetUserSteppingAction());
+    fStepStatistics =
+        &const_cast<SteppingAction *>(steppingAction)->GetStepStatistics();
+    auto runAction = static_cast<const RunAction *>(
+        G4RunManager::GetRunManager()->GetUserRunAction());
+    fMemoryMonitor = &const_cast<RunAction *>(runAction)->GetMemoryMonitor();
+    fTruthEnabled = runAction->IsTruthEnabled();
+  }
+  if (fStepStatistics->IsEnabled())
+    fStepStatistics->BeginTrack(track);
+
+  // 初级粒子的 trackID 按顺序为 1..N；次级继承母径迹的初级序号
+  // （母径迹总是先于它的次级被跟踪，已经登记）
+  size_t trackID = track->GetTrackID();
+  if (trackID >= fPrimaryOfTrack.size())
+    fPrimaryOfTrack.resize(std::max(trackID + 1, 2 * fPrimaryOfTrack.size()));
+  G4int parentID = track->GetParentID();
+  fPrimaryOfTrack[trackID] =
+      parentID == 0 ? static_cast<G4int>(trackID) - 1
+                    : fPrimaryOfTrack[parentID];
+
+  // 超过阈值的次级粒子记入真值表（光学光子除外）
+  if (fTruthEnabled && parentID != 0 &&
+      track->GetKineticEnergy() >= fTruth.GetMinEnergy() &&
+      track->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition())
+    fTruth.Add(track);
+
   // 避免为光子创建轨迹，如果数量太多
   // if (track->GetDefinition() == G4OpticalPhoton::OpticalPhotonDefinition())
   // return;
@@ -18,8 +58,29 @@ void TrackingAction::PreUserTrackingAction(const G4Track *track) {
   //   G4cout << "Optical photon created\n";
   // }
 
-  G4TrackingManager *tm =
-      G4EventManager::GetEventManager()->GetTrackingManager();
+  if (track->GetDefinition() == G4OpticalPhoton::OpticalPhotonDefinition())
+    CSI_BENCH_COUNT(kOpticalPhotons, 1);
+
+  G4EventManager *eventManager = G4EventManager::GetEventManager();
+  G4TrackingManager *tm = eventManager->GetTrackingManager();
+  fMemoryMonitor->SampleStack(eventManager->GetStackManager()->GetNTotalTrack());
+
+  // 有界内存模式：超出 maxTrajectories 的径迹不保存轨迹
+  // （关掉 StoreTrajectory，否则 Geant4 会创建默认的 G4Trajectory）
+  if (!fMemoryMonitor->AcceptTrajectory()) {
+    if (fSavedStoreTrajectory < 0) {
+      fSavedStoreTrajectory = tm->GetStoreTrajectory();
+      tm->SetStoreTrajectory(0);
+    }
+    return;
+  }
+  if (fSavedStoreTrajectory >= 0) {
+    tm->SetStoreTrajectory(fSavedStoreTrajectory);
+    fSavedStoreTrajectory = -1;
+  }
+
+  CSI_BENCH_SCOPE(kTrajectory);
+  CSI_BENCH_COUNT(kTrajectories, 1);
   Trajectory *trajectory = new Trajectory(track);
   tm->SetTrajectory(trajectory);
 }
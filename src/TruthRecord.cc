@@ -0,0 +1,89 @@
+// TruthRecord.cc
+#include "TruthRecord.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "G4VProcess.hh"
+#include "G4ios.hh"
+#include "RunAction.hh"
+
+#include <algorithm>
+
+TruthRecord::TruthRecord()
+    : fMessenger(nullptr), fMinEnergy(100. * keV), fMaxParticles(1000),
+      fDropped(0) {
+  fMessenger = new G4GenericMessenger(this, "/CsI/truth/",
+                                      "MC truth of significant secondaries");
+  fMessenger->DeclarePropertyWithUnit(
+      "minEnergy", "keV", fMinEnergy,
+      "Record secondaries created above this kinetic energy");
+  fMessenger->DeclareProperty("maxParticles", fMaxParticles,
+                              "Truth particles recorded per event");
+  Reserve();
+}
+
+TruthRecord::~TruthRecord() {
+  if (fDropped > 0)
+    G4cout << "[TruthRecord] " << fDropped
+           << " secondaries above threshold not recorded (maxParticles)"
+           << G4endl;
+  delete fMessenger;
+}
+
+void TruthRecord::Reserve() {
+  size_t n = std::max(fMaxParticles, 0);
+  trackID.reserve(n);
+  parentID.reserve(n);
+  pdg.reserve(n);
+  processID.reserve(n);
+  energy.reserve(n);
+  posX.reserve(n);
+  posY.reserve(n);
+  posZ.reserve(n);
+  time.reserve(n);
+}
+
+void TruthRecord::Clear() {
+  trackID.clear();
+  parentID.clear();
+  pdg.clear();
+  processID.clear();
+  energy.clear();
+  posX.clear();
+  posY.clear();
+  posZ.clear();
+  time.clear();
+  // maxParticles 在 run 之间可能被改大
+  if (trackID.capacity() < static_cast<size_t>(std::max(fMaxParticles, 0)))
+    Reserve();
+}
+
+G4int TruthRecord::ProcessID(const G4VProcess *process) {
+  auto it = fProcessIDs.find(process);
+  if (it != fProcessIDs.end())
+    return it->second;
+  auto runAction = static_cast<const RunAction *>(
+      G4RunManager::GetRunManager()->GetUserRunAction());
+  G4int id = const_cast<RunAction *>(runAction)->GetProcessID(
+      process ? process->GetProcessName() : G4String("Primary"));
+  fProcessIDs[process] = id;
+  return id;
+}
+
+void TruthRecord::Add(const G4Track *track) {
+  if (static_cast<G4int>(trackID.size()) >= fMaxParticles) {
+    fDropped++;
+    return;
+  }
+  // PreUserTrackingAction 时 vertex 量还没有设置，当前位置就是产生点
+  const G4ThreeVector &position = track->GetPosition();
+  trackID.push_back(track->GetTrackID());
+  parentID.push_back(track->GetParentID());
+  pdg.push_back(track->GetDefinition()->GetPDGEncoding());
+  processID.push_back(ProcessID(track->GetCreatorProcess()));
+  energy.push_back(track->GetKineticEnergy());
+  posX.push_back(position.x());
+  posY.push_back(position.y());
+  posZ.push_back(position.z());
+  time.push_back(track->GetGlobalTime());
+}
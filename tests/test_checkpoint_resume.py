@@ -0,0 +1,102 @@
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+# 检查点续跑：同一个种子的 run 不中断跑一次；再分段跑一次，在第二个检查点后
+# 退出 (/CsI/checkpoint/exitAfter)，用 /CsI/checkpoint/resume 跑完。
+# 两次的输出逐事件比较。
+#   python3 test_checkpoint_resume.py <CsI_Axion 可执行文件>
+# 没有 uproot 或 hadd 时返回 77（ctest 记为跳过）
+
+SKIP = 77
+EVENTS = 100
+EVERY = 30
+COLUMNS = ["EventID", "TotalEdep", "HitCount", "CrystalIndex", "CrystalEdep"]
+
+
+def settings(output):
+    return f"""
+/control/verbose 0
+/run/verbose 0
+/CsI/output/fileName {output}
+/CsI/generator/mode ePairDeflected
+/run/initialize
+/CsI/random/autoSeed false
+/CsI/random/seed 20240611
+/CsI/random/apply
+"""
+
+
+def run(executable, macro_path, text):
+    with open(macro_path, "w") as f:
+        f.write(text)
+    # 在可执行文件的目录运行：数据表和宏都复制在那里
+    return subprocess.run([executable, macro_path], cwd=os.path.dirname(executable), stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("usage: test_checkpoint_resume.py CsI_Axion")
+        return 2
+    executable = os.path.abspath(sys.argv[1])
+    try:
+        import numpy as np
+        import uproot
+    except ImportError:
+        print("numpy/uproot not available, skipped")
+        return SKIP
+    if shutil.which("hadd") is None:
+        print("hadd not available, skipped")
+        return SKIP
+
+    work = tempfile.mkdtemp(prefix="csi_checkpoint_")
+    try:
+        reference = os.path.join(work, "reference")
+        resumed = os.path.join(work, "resumed")
+
+        result = run(executable, os.path.join(work, "reference.mac"), settings(reference) + f"/run/beamOn {EVENTS}\n")
+        if result.returncode != 0:
+            print(result.stdout)
+            print("FAIL: reference run failed")
+            return 1
+
+        checkpoints = f"/CsI/checkpoint/everyEvents {EVERY}\n"
+        result = run(executable, os.path.join(work, "interrupted.mac"), settings(resumed) + checkpoints + f"/CsI/checkpoint/exitAfter 2\n/run/beamOn {EVENTS}\n")
+        if result.returncode == 0 or not os.path.exists(resumed + ".checkpoint"):
+            print(result.stdout)
+            print("FAIL: the interrupted run did not stop at its second checkpoint")
+            return 1
+
+        result = run(executable, os.path.join(work, "resume.mac"), settings(resumed) + checkpoints + "/CsI/checkpoint/resume\n")
+        if result.returncode != 0 or not os.path.exists(resumed + ".root"):
+            print(result.stdout)
+            print("FAIL: resume did not produce the merged output")
+            return 1
+
+        with uproot.open(reference + ".root") as f:
+            expected = f["CsI"].arrays(COLUMNS, library="np")
+        with uproot.open(resumed + ".root") as f:
+            actual = f["CsI"].arrays(COLUMNS, library="np")
+
+        failed = False
+        for column in COLUMNS:
+            a, b = expected[column], actual[column]
+            same = len(a) == len(b) and all(np.array_equal(x, y) for x, y in zip(a, b))
+            if not same:
+                print(f"FAIL: column {column} differs ({len(a)} vs {len(b)} entries)")
+                failed = True
+        if len(expected["EventID"]) != EVENTS:
+            print(f"FAIL: {len(expected['EventID'])} events in the reference, expected {EVENTS}")
+            failed = True
+        if failed:
+            return 1
+        print(f"resumed run matches the uninterrupted run ({EVENTS} events)")
+        return 0
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,83 @@
+import argparse
+import struct
+
+import numpy as np
+
+# 二进制顶点文件格式，与 MappedVertexGenerator (PrimaryGenerators.hh) 一致
+MAGIC = b"CSIVTX01"
+VERSION = 1
+HEADER = struct.Struct("<8sIIQQ")
+RECORD_DTYPE = np.dtype(
+    [
+        ("x", "<f8"),
+        ("y", "<f8"),
+        ("z", "<f8"),
+        ("t", "<f8"),
+        ("px", "<f8"),
+        ("py", "<f8"),
+        ("pz", "<f8"),
+        ("weight", "<f4"),
+        ("pdg", "<i4"),
+    ]
+)
+
+
+def write_vertex_file(filename, event, records):
+    """
+    写出二进制顶点文件
+    event: 每个粒子所属的事件号（同一事件的粒子必须相邻）
+    records: RECORD_DTYPE 结构数组，单位 mm, ns, MeV
+    """
+    event = np.asarray(event)
+    records = np.asarray(records, dtype=RECORD_DTYPE)
+    if len(event) != len(records):
+        raise ValueError("event and records must have the same length")
+
+    starts = np.flatnonzero(np.r_[True, event[1:] != event[:-1]]) if len(event) else np.array([], dtype=np.int64)
+    offsets = np.append(starts, len(records)).astype("<u8")
+
+    with open(filename, "wb") as f:
+        f.write(HEADER.pack(MAGIC, VERSION, RECORD_DTYPE.itemsize, len(starts), len(records)))
+        f.write(offsets.tobytes())
+        f.write(records.tobytes())
+    print(f"[Info] Wrote {len(starts)} events ({len(records)} particles) to '{filename}'")
+
+
+def read_vertex_file(filename):
+    """读取二进制顶点文件，返回 (offsets, records)，records 为只读内存映射"""
+    with open(filename, "rb") as f:
+        magic, version, record_size, n_events, n_particles = HEADER.unpack(f.read(HEADER.size))
+    if magic != MAGIC or record_size != RECORD_DTYPE.itemsize:
+        raise ValueError(f"'{filename}' is not a vertex file")
+    offsets = np.memmap(filename, dtype="<u8", mode="r", offset=HEADER.size, shape=(n_events + 1,))
+    records = np.memmap(filename, dtype=RECORD_DTYPE, mode="r", offset=HEADER.size + offsets.nbytes, shape=(n_particles,))
+    return offsets, records
+
+
+def convert_text(text_file, binary_file):
+    """
+    文本顶点列表 -> 二进制
+    每行: event PDG x y z t px py pz [weight]
+    """
+    rows = []
+    with open(text_file, "r") as f:
+        for line in f:
+            if not line.strip() or line.startswith("#"):
+                continue
+            parts = line.split()
+            weight = float(parts[9]) if len(parts) > 9 else 1.0
+            rows.append((int(parts[0]), int(parts[1]), *map(float, parts[2:9]), weight))
+
+    records = np.zeros(len(rows), dtype=RECORD_DTYPE)
+    event = np.array([r[0] for r in rows], dtype=np.int64)
+    for name, column in zip(["pdg", "x", "y", "z", "t", "px", "py", "pz", "weight"], range(1, 10)):
+        records[name] = [r[column] for r in rows]
+    write_vertex_file(binary_file, event, records)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Convert a text vertex list to the binary vertex file read by /CsI/generator/vertexBinary.")
+    parser.add_argument("input", help="Text vertex list: event PDG x y z t px py pz [weight]")
+    parser.add_argument("output", help="Binary vertex file")
+    args = parser.parse_args()
+    convert_text(args.input, args.output)